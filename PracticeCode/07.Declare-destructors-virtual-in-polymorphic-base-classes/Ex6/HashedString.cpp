@@ -0,0 +1,196 @@
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+// Ex3 中的 SpecialString 为了添加功能而继承 std::string，通过基类指针 delete
+// 时不会调用派生类析构函数。这里换一种思路：不继承任何类，用组合实现一个
+// 不可变、缓存哈希值的字符串，专门用作哈希表的 key。
+//
+// - 长度 < 24 的字符串直接存放在对象内部的 24 字节缓冲区中（含结尾 '\0'）
+// - 更长的字符串放在堆上，由多个副本通过引用计数共享，拷贝代价为 O(1)
+// - 哈希值只在构造时计算一次
+class HashedString {
+public:
+    static const std::size_t kInlineCapacity = 24;
+
+    HashedString() : m_size(0), m_hash(hashOf(std::string_view())) {
+        m_inline[0] = '\0';
+    }
+
+    HashedString(std::string_view s)
+        : m_size(s.size()), m_hash(hashOf(s)) {
+        char* dst;
+        if (isInline()) {
+            dst = m_inline;
+        } else {
+            m_heap = Rep::create(s.size());
+            dst = m_heap->data;
+        }
+        std::memcpy(dst, s.data(), s.size());
+        dst[s.size()] = '\0';
+    }
+
+    HashedString(const char* s) : HashedString(std::string_view(s)) {}
+    HashedString(const std::string& s) : HashedString(std::string_view(s)) {}
+
+    HashedString(const HashedString& rhs)
+        : m_size(rhs.m_size), m_hash(rhs.m_hash) {
+        if (isInline()) {
+            std::memcpy(m_inline, rhs.m_inline, kInlineCapacity);
+        } else {
+            m_heap = rhs.m_heap;
+            m_heap->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    HashedString& operator=(const HashedString& rhs) {
+        HashedString tmp(rhs);  // copy and swap，自我赋值也安全
+        swap(tmp);
+        return *this;
+    }
+
+    ~HashedString() {
+        if (!isInline()) Rep::release(m_heap);
+    }
+
+    // 不提供任何修改接口：对象一经构造便不可变，缓存的哈希值始终有效
+    const char* data() const { return isInline() ? m_inline : m_heap->data; }
+    const char* c_str() const { return data(); }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    std::size_t hash() const { return m_hash; }
+
+    operator std::string_view() const { return std::string_view(data(), m_size); }
+    std::string str() const { return std::string(data(), m_size); }
+
+    // 逐个成员交换。联合体按两边各自的存放方式分别处理
+    void swap(HashedString& rhs) {
+        if (isInline() && rhs.isInline()) {
+            std::swap(m_inline, rhs.m_inline);
+        } else if (!isInline() && !rhs.isInline()) {
+            std::swap(m_heap, rhs.m_heap);
+        } else {
+            HashedString& small = isInline() ? *this : rhs;
+            HashedString& large = isInline() ? rhs : *this;
+            Rep* heap = large.m_heap;
+            std::memcpy(large.m_inline, small.m_inline, kInlineCapacity);
+            small.m_heap = heap;
+        }
+        std::swap(m_size, rhs.m_size);
+        std::swap(m_hash, rhs.m_hash);
+    }
+
+    friend bool operator==(const HashedString& lhs, const HashedString& rhs) {
+        if (lhs.m_hash != rhs.m_hash || lhs.m_size != rhs.m_size) return false;
+        if (!lhs.isInline() && lhs.m_heap == rhs.m_heap) return true;
+        return std::memcmp(lhs.data(), rhs.data(), lhs.m_size) == 0;
+    }
+
+    friend bool operator!=(const HashedString& lhs, const HashedString& rhs) {
+        return !(lhs == rhs);
+    }
+
+    // 仅用于演示：统计堆上分配了多少个 Rep
+    static std::size_t heapAllocations() { return s_allocations.load(); }
+
+private:
+    struct Rep {
+        std::atomic<std::size_t> refs;
+        char data[1];
+
+        static Rep* create(std::size_t len) {
+            void* mem = ::operator new(offsetof(Rep, data) + len + 1);
+            s_allocations.fetch_add(1, std::memory_order_relaxed);
+            Rep* rep = static_cast<Rep*>(mem);
+            new (&rep->refs) std::atomic<std::size_t>(1);
+            return rep;
+        }
+
+        static void release(Rep* rep) {
+            if (rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                rep->refs.~atomic();
+                ::operator delete(rep);
+            }
+        }
+    };
+
+    // FNV-1a，结果与平台的 std::hash 无关，方便持久化或跨进程比较
+    static std::size_t hashOf(std::string_view s) {
+        std::size_t h = static_cast<std::size_t>(14695981039346656037ULL);
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= static_cast<std::size_t>(1099511628211ULL);
+        }
+        return h;
+    }
+
+    bool isInline() const { return m_size < kInlineCapacity; }
+
+    std::size_t m_size;
+    std::size_t m_hash;
+    union {
+        char m_inline[kInlineCapacity];
+        Rep* m_heap;
+    };
+
+    static std::atomic<std::size_t> s_allocations;  // 多个线程可能同时构造
+};
+
+std::atomic<std::size_t> HashedString::s_allocations(0);
+
+namespace std {
+template <>
+struct hash<HashedString> {
+    std::size_t operator()(const HashedString& s) const { return s.hash(); }
+};
+}  // namespace std
+
+int main() {
+    // 没有虚函数，也没有继承关系，不存在 Ex3 中通过基类指针析构的问题
+    std::cout << "Size of HashedString: " << sizeof(HashedString) << std::endl;
+
+    HashedString shortKey("apple");
+    HashedString longKey("a key that is definitely longer than 24 bytes");
+    std::cout << "heap allocations: " << HashedString::heapAllocations()
+              << std::endl;  // 1
+
+    {
+        HashedString copy1 = longKey;
+        HashedString copy2 = copy1;
+        std::cout << "after copies, heap allocations: "
+                  << HashedString::heapAllocations() << std::endl;  // 仍为 1
+        std::cout << "copy equals original: " << (copy2 == longKey)
+                  << std::endl;
+    }
+
+    std::unordered_map<HashedString, int> prices;
+    prices[shortKey] = 3;
+    prices[longKey] = 42;
+    for (int i = 0; i < 1000000; ++i) {
+        prices[longKey] += 1;  // 每次查找都直接使用缓存的哈希值
+    }
+    std::cout << shortKey.c_str() << " -> " << prices[shortKey] << std::endl;
+    std::cout << longKey.c_str() << " -> " << prices[longKey] << std::endl;
+
+    std::string_view view = longKey;
+    std::cout << "string_view size: " << view.size() << std::endl;
+
+    HashedString a("left"), b("right");
+    a = b;
+    a = a;
+    std::cout << "after assignment: " << a.c_str() << std::endl;
+
+    HashedString c(longKey);
+    a.swap(c);  // 内联和堆上的字符串互换
+    a = shortKey;
+    std::cout << "after swap: " << c.c_str() << ", " << a.c_str() << " == "
+              << shortKey.c_str() << ": " << (a == shortKey) << std::endl;
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,2 @@
+g++ HashedString.cpp -o HashedString.out -std=c++17
+./HashedString.out
\ No newline at end of file
@@ -0,0 +1,776 @@
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 基于 C++20 协程和 epoll 的异步 DBConnection。
+// 每个线程运行一个单线程事件循环，一个逻辑连接只占用一个协程帧而不是一个
+// 线程。所有 I/O 等待都支持超时和取消。
+
+typedef std::chrono::steady_clock Clock;
+
+class TimeoutError : public std::runtime_error {
+public:
+    TimeoutError() : std::runtime_error("operation timed out") {}
+};
+
+class CancelledError : public std::runtime_error {
+public:
+    CancelledError() : std::runtime_error("operation cancelled") {}
+};
+
+// ---------------------------------------------------------------------------
+// Task<T>：惰性启动的协程，被 co_await 时才开始执行，结束后恢复等待者
+
+template <typename T>
+class Task;
+
+namespace detail {
+
+struct PromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<P> h) noexcept {
+            std::coroutine_handle<> next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    Task<T> get_return_object();
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T result() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+    std::optional<T> value;  // T 不必有默认构造函数
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void result() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+}  // namespace detail
+
+template <typename T = void>
+class Task {
+public:
+    typedef detail::Promise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    explicit Task(Handle h) : handle(h) {}
+    Task(Task&& rhs) noexcept : handle(std::exchange(rhs.handle, nullptr)) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> waiter) {
+        handle.promise().continuation = waiter;
+        return handle;
+    }
+    T await_resume() { return handle.promise().result(); }
+
+private:
+    Handle handle;
+};
+
+namespace detail {
+template <typename T>
+Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T> >::from_promise(*this));
+}
+inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(
+        std::coroutine_handle<Promise<void> >::from_promise(*this));
+}
+}  // namespace detail
+
+// ---------------------------------------------------------------------------
+// 取消：CancelSource::cancel() 会立即结束与之关联的 I/O 等待
+
+class EventLoop;
+
+struct Waiter {
+    enum Result { Pending, Ready, TimedOut, Cancelled, Closed };
+
+    EventLoop* loop;
+    std::coroutine_handle<> handle;
+    Result result;
+    int fd;
+    bool forWrite;
+    std::multimap<Clock::time_point, Waiter*>::iterator timer;
+    bool hasTimer;
+    struct CancelState* cancel;
+};
+
+struct CancelState {
+    CancelState() : cancelled(false), waiter(nullptr) {}
+    bool cancelled;
+    Waiter* waiter;  // 当前正在等待的操作
+};
+
+class CancelToken {
+public:
+    CancelToken() {}
+    explicit CancelToken(std::shared_ptr<CancelState> s) : state(s) {}
+    bool cancelled() const { return state && state->cancelled; }
+    CancelState* get() const { return state.get(); }
+
+private:
+    std::shared_ptr<CancelState> state;
+};
+
+class CancelSource {
+public:
+    CancelSource() : state(std::make_shared<CancelState>()) {}
+    CancelToken token() const { return CancelToken(state); }
+    void cancel();
+
+private:
+    std::shared_ptr<CancelState> state;
+};
+
+// ---------------------------------------------------------------------------
+// 单线程 epoll 事件循环
+
+class EventLoop {
+public:
+    EventLoop() : epfd(::epoll_create1(EPOLL_CLOEXEC)), detached(0) {
+        if (epfd < 0) throw std::runtime_error("epoll_create1 failed");
+    }
+
+    ~EventLoop() { ::close(epfd); }
+
+    // 等待 fd 可读/可写，或超时/被取消
+    class IoAwaiter {
+    public:
+        IoAwaiter(EventLoop& loop, int fd, bool forWrite,
+                  Clock::time_point deadline, CancelToken token)
+            : deadline(deadline), token(token) {
+            w.loop = &loop;
+            w.result = Waiter::Pending;
+            w.fd = fd;
+            w.forWrite = forWrite;
+            w.hasTimer = false;
+            w.cancel = token.get();
+        }
+
+        bool await_ready() const { return token.cancelled(); }
+        void await_suspend(std::coroutine_handle<> h) {
+            w.handle = h;
+            w.loop->arm(&w, deadline);
+        }
+        void await_resume() {
+            if (token.cancelled() && w.result != Waiter::Ready) {
+                throw CancelledError();
+            }
+            if (w.result == Waiter::TimedOut) throw TimeoutError();
+            if (w.result == Waiter::Closed) {
+                throw std::runtime_error("fd closed while waiting");
+            }
+        }
+
+    private:
+        Waiter w;
+        Clock::time_point deadline;
+        CancelToken token;
+    };
+
+    IoAwaiter readable(int fd, Clock::time_point deadline,
+                       CancelToken token = CancelToken()) {
+        return IoAwaiter(*this, fd, false, deadline, token);
+    }
+
+    IoAwaiter writable(int fd, Clock::time_point deadline,
+                       CancelToken token = CancelToken()) {
+        return IoAwaiter(*this, fd, true, deadline, token);
+    }
+
+    // 单纯的定时等待，超时是正常结果
+    Task<> sleep(Clock::duration d, CancelToken token = CancelToken()) {
+        try {
+            co_await IoAwaiter(*this, -1, false, Clock::now() + d, token);
+        } catch (const TimeoutError&) {
+        }
+    }
+
+    // 启动一个独立运行的协程，异常会被吞掉并打印
+    void spawn(Task<> task) { startDetached(std::move(task)); }
+
+    // 运行直到没有任何待处理的工作
+    void run() {
+        epoll_event events[256];
+        while (detached > 0 || !ready.empty()) {
+            drainReady();
+            if (detached == 0) break;
+            int timeout = -1;
+            if (!timers.empty()) {
+                Clock::duration left = timers.begin()->first - Clock::now();
+                timeout = std::max<long>(
+                    0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                           left + std::chrono::microseconds(999))
+                           .count());
+            }
+            int n = ::epoll_wait(epfd, events, 256, timeout);
+            if (n < 0 && errno != EINTR) {
+                throw std::runtime_error("epoll_wait failed");
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                uint32_t ev = events[i].events;
+                bool err = ev & (EPOLLERR | EPOLLHUP);
+                if ((ev & EPOLLIN || err) && fds[fd].reader) {
+                    complete(fds[fd].reader, Waiter::Ready);
+                }
+                if ((ev & EPOLLOUT || err) && fds[fd].writer) {
+                    complete(fds[fd].writer, Waiter::Ready);
+                }
+            }
+            Clock::time_point now = Clock::now();
+            while (!timers.empty() && timers.begin()->first <= now) {
+                complete(timers.begin()->second, Waiter::TimedOut);
+            }
+        }
+    }
+
+    // fd 关闭前调用，清除 epoll 中的登记。仍在等待该 fd 的协程会被恢复，
+    // 并在 co_await 处收到异常，不会永远挂起
+    void forget(int fd) {
+        if (fd >= static_cast<int>(fds.size())) return;
+        if (fds[fd].reader) complete(fds[fd].reader, Waiter::Closed);
+        if (fds[fd].writer) complete(fds[fd].writer, Waiter::Closed);
+        if (fds[fd].registered) ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+        fds[fd] = FdState();
+    }
+
+    void complete(Waiter* w, Waiter::Result r) {
+        if (w->result != Waiter::Pending) return;
+        w->result = r;
+        if (w->hasTimer) timers.erase(w->timer);
+        if (w->cancel && w->cancel->waiter == w) w->cancel->waiter = nullptr;
+        if (w->fd >= 0) {
+            FdState& s = fds[w->fd];
+            (w->forWrite ? s.writer : s.reader) = nullptr;
+            updateInterest(w->fd);
+        }
+        ready.push_back(w->handle);
+    }
+
+private:
+    struct FdState {
+        FdState() : reader(nullptr), writer(nullptr), registered(false),
+                    events(0) {}
+        Waiter* reader;
+        Waiter* writer;
+        bool registered;
+        uint32_t events;
+    };
+
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() {}
+        };
+    };
+
+    Detached startDetached(Task<> task) {
+        ++detached;
+        try {
+            co_await task;
+        } catch (const std::exception& e) {
+            std::cout << "detached task failed: " << e.what() << std::endl;
+        } catch (...) {
+            std::cout << "detached task failed." << std::endl;
+        }
+        --detached;
+    }
+
+    void arm(Waiter* w, Clock::time_point deadline) {
+        if (deadline != Clock::time_point::max()) {
+            w->timer = timers.insert(std::make_pair(deadline, w));
+            w->hasTimer = true;
+        }
+        if (w->cancel) w->cancel->waiter = w;
+        if (w->fd >= 0) {
+            if (w->fd >= static_cast<int>(fds.size())) fds.resize(w->fd + 1);
+            (w->forWrite ? fds[w->fd].writer : fds[w->fd].reader) = w;
+            updateInterest(w->fd);
+        }
+    }
+
+    // 没有等待者时从 epoll 中删除：EPOLLHUP/EPOLLERR 总会上报，保留一个
+    // events 为 0 的登记，空闲连接被对端挂断后 run() 就会空转
+    void updateInterest(int fd) {
+        FdState& s = fds[fd];
+        uint32_t want = (s.reader ? uint32_t(EPOLLIN) : 0u) |
+                        (s.writer ? uint32_t(EPOLLOUT) : 0u);
+        if (want == 0) {
+            if (s.registered) ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+            s.registered = false;
+            s.events = 0;
+            return;
+        }
+        if (want == s.events && s.registered) return;
+        epoll_event ev;
+        ev.events = want;
+        ev.data.fd = fd;
+        if (::epoll_ctl(epfd, s.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                        fd, &ev) < 0 &&
+            errno == ENOENT) {
+            ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        }
+        s.registered = true;
+        s.events = want;
+    }
+
+    void drainReady() {
+        while (!ready.empty()) {
+            std::coroutine_handle<> h = ready.front();
+            ready.pop_front();
+            h.resume();
+        }
+    }
+
+    int epfd;
+    long detached;
+    std::vector<FdState> fds;
+    std::multimap<Clock::time_point, Waiter*> timers;
+    std::deque<std::coroutine_handle<> > ready;
+};
+
+void CancelSource::cancel() {
+    state->cancelled = true;
+    if (state->waiter) {
+        state->waiter->loop->complete(state->waiter, Waiter::Cancelled);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 非阻塞 socket 读写辅助函数。协议：[uint32 长度][负载]
+
+namespace io {
+
+Task<> writeAll(EventLoop& loop, int fd, std::string data,
+                Clock::time_point deadline, CancelToken token) {
+    std::size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::send(fd, data.data() + done, data.size() - done,
+                           MSG_NOSIGNAL);
+        if (n >= 0) {
+            done += n;
+        } else if (errno == EAGAIN) {
+            co_await loop.writable(fd, deadline, token);
+        } else {
+            throw std::runtime_error("send failed");
+        }
+    }
+}
+
+// 读满 n 字节；对端在读到任何数据前关闭时返回 false
+Task<bool> readExact(EventLoop& loop, int fd, char* buf, std::size_t n,
+                     Clock::time_point deadline, CancelToken token) {
+    std::size_t done = 0;
+    while (done < n) {
+        ssize_t r = ::read(fd, buf + done, n - done);
+        if (r > 0) {
+            done += r;
+        } else if (r == 0) {
+            if (done == 0) co_return false;
+            throw std::runtime_error("connection closed mid-frame");
+        } else if (errno == EAGAIN) {
+            co_await loop.readable(fd, deadline, token);
+        } else {
+            throw std::runtime_error("read failed");
+        }
+    }
+    co_return true;
+}
+
+std::string frame(const std::string& payload) {
+    uint32_t len = static_cast<uint32_t>(payload.size());
+    std::string out(reinterpret_cast<const char*>(&len), sizeof(len));
+    return out + payload;
+}
+
+Task<bool> readFrame(EventLoop& loop, int fd, std::string& payload,
+                     Clock::time_point deadline, CancelToken token) {
+    uint32_t len;
+    if (!co_await readExact(loop, fd, reinterpret_cast<char*>(&len),
+                            sizeof(len), deadline, token)) {
+        co_return false;
+    }
+    payload.resize(len);
+    if (len && !co_await readExact(loop, fd, &payload[0], len, deadline,
+                                   token)) {
+        throw std::runtime_error("connection closed mid-frame");
+    }
+    co_return true;
+}
+
+sockaddr_un address(const std::string& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+}  // namespace io
+
+// ---------------------------------------------------------------------------
+// 运行在同一个事件循环上的本地替身服务端。请求 "slow" 会延迟 200ms 才应答
+
+class StandInServer {
+public:
+    StandInServer(EventLoop& loop_, const std::string& path_)
+        : loop(loop_), path(path_) {
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        sockaddr_un addr = io::address(path);
+        ::unlink(path.c_str());
+        if (listenFd < 0 ||
+            ::bind(listenFd, reinterpret_cast<sockaddr*>(&addr),
+                   sizeof(addr)) < 0 ||
+            ::listen(listenFd, SOMAXCONN) < 0) {
+            throw std::runtime_error("StandInServer: cannot listen");
+        }
+        loop.spawn(acceptLoop());
+    }
+
+    ~StandInServer() {
+        loop.forget(listenFd);
+        ::close(listenFd);
+        ::unlink(path.c_str());
+    }
+
+    void stop() { stopper.cancel(); }
+
+private:
+    Task<> acceptLoop() {
+        CancelToken token = stopper.token();
+        while (!token.cancelled()) {
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd >= 0) {
+                loop.spawn(serve(loop, fd));
+                continue;
+            }
+            if (errno != EAGAIN) throw std::runtime_error("accept failed");
+            try {
+                co_await loop.readable(listenFd, Clock::time_point::max(),
+                                       token);
+            } catch (const CancelledError&) {
+                co_return;
+            }
+        }
+    }
+
+    static Task<> serve(EventLoop& loop, int fd) {
+        std::string request;
+        Clock::time_point never = Clock::time_point::max();
+        try {
+            while (co_await io::readFrame(loop, fd, request, never,
+                                          CancelToken())) {
+                if (request == "slow") {
+                    co_await loop.sleep(std::chrono::milliseconds(200));
+                }
+                co_await io::writeAll(loop, fd,
+                                      io::frame("value of " + request), never,
+                                      CancelToken());
+            }
+        } catch (const std::exception&) {
+            // 客户端超时或取消后直接断开连接，这里不需要处理
+        }
+        loop.forget(fd);
+        ::close(fd);
+    }
+
+    EventLoop& loop;
+    std::string path;
+    int listenFd;
+    CancelSource stopper;
+};
+
+// ---------------------------------------------------------------------------
+
+class DBConnection {
+public:
+    static Task<DBConnection> create(EventLoop& loop, std::string path,
+                                     Clock::duration timeout,
+                                     CancelToken token = CancelToken()) {
+        Clock::time_point deadline = Clock::now() + timeout;
+        sockaddr_un addr = io::address(path);
+        for (;;) {
+            int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            if (fd < 0) throw std::runtime_error("socket failed");
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&addr),
+                          sizeof(addr)) == 0) {
+                co_return DBConnection(loop, fd);
+            }
+            int err = errno;
+            ::close(fd);
+            // Unix socket 的监听队列满时返回 EAGAIN，稍后重试
+            if (err != EAGAIN) throw std::runtime_error("connect failed");
+            if (Clock::now() >= deadline) throw TimeoutError();
+            co_await loop.sleep(std::chrono::milliseconds(1), token);
+            if (token.cancelled()) throw CancelledError();
+        }
+    }
+
+    DBConnection(DBConnection&& rhs) noexcept
+        : loop(rhs.loop), fd(std::exchange(rhs.fd, -1)) {}
+    DBConnection(const DBConnection&) = delete;
+    DBConnection& operator=(const DBConnection&) = delete;
+
+    ~DBConnection() { closeNow(); }
+
+    // 发送一个请求并等待响应。超时或取消后连接状态不可知，直接关闭
+    Task<std::string> request(std::string req, Clock::duration timeout,
+                              CancelToken token = CancelToken()) {
+        if (fd < 0) throw std::runtime_error("connection closed");
+        Clock::time_point deadline = Clock::now() + timeout;
+        std::string response;
+        try {
+            co_await io::writeAll(*loop, fd, io::frame(req), deadline, token);
+            if (!co_await io::readFrame(*loop, fd, response, deadline, token)) {
+                throw std::runtime_error("server closed connection");
+            }
+        } catch (...) {
+            closeNow();
+            throw;
+        }
+        co_return response;
+    }
+
+    // 优雅关闭：先关闭写端，等待服务端确认后再释放 fd
+    Task<> close(Clock::duration timeout = std::chrono::seconds(1)) {
+        if (fd < 0) co_return;
+        ::shutdown(fd, SHUT_WR);
+        Clock::time_point deadline = Clock::now() + timeout;
+        std::string ignored;
+        try {
+            while (co_await io::readFrame(*loop, fd, ignored, deadline,
+                                          CancelToken())) {
+            }
+        } catch (...) {
+            closeNow();
+            throw;
+        }
+        closeNow();
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+private:
+    DBConnection(EventLoop& loop_, int fd_) : loop(&loop_), fd(fd_) {}
+
+    void closeNow() {
+        if (fd < 0) return;
+        loop->forget(fd);
+        ::close(fd);
+        fd = -1;
+    }
+
+    EventLoop* loop;
+    int fd;
+};
+
+// 析构函数不能 co_await，所以 DBConn 在析构时若连接尚未关闭，就把关闭操作
+// 交给事件循环在后台完成；需要得知关闭结果的调用者应显式 co_await close()。
+class DBConn {
+public:
+    DBConn(EventLoop& loop_, DBConnection db_)
+        : loop(loop_), db(new DBConnection(std::move(db_))) {}
+    DBConn(const DBConn&) = delete;
+    DBConn& operator=(const DBConn&) = delete;
+
+    DBConnection& connection() { return *db; }
+
+    Task<> close() { co_await db->close(); }
+
+    ~DBConn() {
+        if (db->isOpen()) {
+            try {
+                loop.spawn(closeInBackground(std::move(db)));
+            } catch (...) {
+                std::cout << "close fail!" << std::endl;
+            }
+        }
+    }
+
+private:
+    static Task<> closeInBackground(std::unique_ptr<DBConnection> db) {
+        co_await db->close();
+    }
+
+    EventLoop& loop;
+    std::unique_ptr<DBConnection> db;
+};
+
+// ---------------------------------------------------------------------------
+
+struct Stats {
+    Stats() : active(0), peak(0), ok(0), failed(0) {}
+    long active, peak, ok, failed;
+};
+
+Task<> client(EventLoop& loop, std::string path, int id, Stats& stats) {
+    try {
+        DBConnection db = co_await DBConnection::create(
+            loop, path, std::chrono::seconds(10));
+        DBConn dbc(loop, std::move(db));
+        stats.peak = std::max(stats.peak, ++stats.active);
+        // 等所有连接都建立后再发请求，保证它们同时在线
+        co_await loop.sleep(std::chrono::milliseconds(300));
+        for (int i = 0; i < 3; ++i) {
+            std::string key = "key" + std::to_string(id * 3 + i);
+            std::string value = co_await dbc.connection().request(
+                key, std::chrono::seconds(10));
+            if (value != "value of " + key) {
+                throw std::runtime_error("bad value");
+            }
+        }
+        --stats.active;
+        co_await dbc.close();
+        ++stats.ok;
+    } catch (const std::exception&) {
+        ++stats.failed;
+    }
+}
+
+Task<> demoTimeoutAndCancel(EventLoop& loop, std::string path) {
+    {
+        DBConnection db = co_await DBConnection::create(
+            loop, path, std::chrono::seconds(1));
+        DBConn dbc(loop, std::move(db));
+        try {
+            co_await dbc.connection().request("slow",
+                                              std::chrono::milliseconds(50));
+        } catch (const TimeoutError& e) {
+            std::cout << "slow request: " << e.what() << std::endl;
+        }
+    }
+    {
+        DBConnection db = co_await DBConnection::create(
+            loop, path, std::chrono::seconds(1));
+        DBConn dbc(loop, std::move(db));
+        CancelSource source;
+        loop.spawn([](EventLoop& loop, CancelSource source) -> Task<> {
+            co_await loop.sleep(std::chrono::milliseconds(20));
+            source.cancel();
+        }(loop, source));
+        try {
+            co_await dbc.connection().request("slow", std::chrono::seconds(1),
+                                              source.token());
+        } catch (const CancelledError& e) {
+            std::cout << "cancelled request: " << e.what() << std::endl;
+        }
+    }
+    // 未显式关闭的 DBConn 在析构时已把关闭操作交给事件循环
+}
+
+void runLoop(int index, int connections, Stats& stats, double& seconds) {
+    EventLoop loop;
+    std::string path =
+        "/tmp/effective-cpp-item08-ex10-" + std::to_string(index) + ".sock";
+    StandInServer server(loop, path);
+
+    loop.spawn([](EventLoop& loop, StandInServer& server, std::string path,
+                  int index, int connections, Stats& stats,
+                  double& seconds) -> Task<> {
+        if (index == 0) co_await demoTimeoutAndCancel(loop, path);
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < connections; ++i) {
+            loop.spawn(client(loop, path, i, stats));
+        }
+        while (stats.ok + stats.failed < connections) {
+            co_await loop.sleep(std::chrono::milliseconds(5));
+        }
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        server.stop();
+    }(loop, server, path, index, connections, stats, seconds));
+
+    loop.run();
+}
+
+int main(int argc, char** argv) {
+    // 每个连接在本进程中占用客户端和服务端两个 fd
+    rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    long wanted = argc > 1 ? std::atol(argv[1]) : 100000;
+    long possible = (static_cast<long>(limit.rlim_cur) - 256) / 2;
+    long total = std::min(wanted, possible);
+    if (total < wanted) {
+        std::cout << "RLIMIT_NOFILE allows only " << total
+                  << " concurrent connections" << std::endl;
+    }
+
+    int loops = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<Stats> stats(loops);
+    std::vector<double> seconds(loops);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < loops; ++i) {
+        threads.emplace_back(runLoop, i, static_cast<int>(total / loops),
+                             std::ref(stats[i]), std::ref(seconds[i]));
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+    long ok = 0, failed = 0, peak = 0;
+    double worst = 0;
+    for (int i = 0; i < loops; ++i) {
+        ok += stats[i].ok;
+        failed += stats[i].failed;
+        peak += stats[i].peak;
+        worst = std::max(worst, seconds[i]);
+    }
+    std::cout << loops << " event loop(s), peak concurrent connections: "
+              << peak << ", ok: " << ok << ", failed: " << failed << ", "
+              << worst << " s" << std::endl;
+
+    return 0;
+}
\ No newline at end of file
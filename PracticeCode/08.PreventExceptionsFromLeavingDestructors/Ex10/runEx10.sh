@@ -0,0 +1,2 @@
+g++ main.cpp -o main.out -std=c++20 -O2 -pthread
+./main.out
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// 用于测试的 DBConnection 替身：建立连接需要一定的时间（可配置）
+class DBConnection {
+public:
+    static DBConnection create() {
+        std::this_thread::sleep_for(setupLatency);
+        ++created;
+        DBConnection db;
+        return db;
+    };
+
+    bool ping() const { return healthy; }  // 健康检查
+    void close() { ++closed; }
+    void markBroken() { healthy = false; }  // 模拟连接失效
+
+    static std::chrono::microseconds setupLatency;
+    static std::atomic<int> created;
+    static std::atomic<int> closed;
+
+private:
+    DBConnection() : healthy(true) {}
+
+    bool healthy;
+};
+
+std::chrono::microseconds DBConnection::setupLatency(2000);
+std::atomic<int> DBConnection::created(0);
+std::atomic<int> DBConnection::closed(0);
+
+// 固定容量的连接池。每个槽位的状态用一个原子变量表示，checkout 和 release
+// 只需要一次 CAS / store，不需要加锁。只有在池满时才会退化为让出 CPU 后重试。
+class DBConnectionPool {
+public:
+    explicit DBConnectionPool(std::size_t capacity_)
+        : capacity(capacity_), slots(new Slot[capacity_]) {}
+
+    ~DBConnectionPool() {
+        for (std::size_t i = 0; i < capacity; ++i) {
+            if (slots[i].state.load() != Empty) closeQuietly(i);
+        }
+        delete[] slots;
+    }
+
+    // 取出一个连接，返回槽位编号。超时仍取不到则抛出异常
+    std::size_t checkout(std::chrono::milliseconds timeout) {
+        Clock::time_point deadline = Clock::now() + timeout;
+        for (;;) {
+            std::size_t index;
+            // 1. 优先尝试当前线程上一次使用的槽位（线程亲和缓存）
+            if (lastSlot < capacity && tryAcquire(lastSlot, Idle)) {
+                return prepare(lastSlot);
+            }
+            // 2. 尝试任意一个空闲的连接
+            if (scan(Idle, index)) return prepare(index);
+            // 3. 尝试在一个空槽位上新建连接
+            if (scan(Empty, index)) {
+                try {
+                    slots[index].conn.assign(1, DBConnection::create());
+                } catch (...) {
+                    slots[index].state.store(Empty, std::memory_order_release);
+                    throw;
+                }
+                lastSlot = index;
+                return index;
+            }
+            // 4. 池已满，等待其它线程归还
+            if (Clock::now() >= deadline) {
+                throw std::runtime_error("DBConnectionPool: checkout timeout");
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    // 归还连接，只做一次 store，不会抛出异常
+    void release(std::size_t index) {
+        slots[index].lastUsed.store(Clock::now().time_since_epoch().count(),
+                                    std::memory_order_relaxed);
+        slots[index].state.store(Idle, std::memory_order_release);
+    }
+
+    DBConnection& get(std::size_t index) { return slots[index].conn[0]; }
+
+    // 关闭空闲时间超过 maxIdle 的连接，返回被关闭的连接数
+    std::size_t evictIdle(std::chrono::milliseconds maxIdle) {
+        std::size_t evicted = 0;
+        Clock::rep now = Clock::now().time_since_epoch().count();
+        Clock::rep limit =
+            std::chrono::duration_cast<Clock::duration>(maxIdle).count();
+        for (std::size_t i = 0; i < capacity; ++i) {
+            if (!tryAcquire(i, Idle)) continue;
+            if (now - slots[i].lastUsed.load(std::memory_order_relaxed) >=
+                limit) {
+                closeSlot(i);
+                ++evicted;
+            } else {
+                slots[i].state.store(Idle, std::memory_order_release);
+            }
+        }
+        return evicted;
+    }
+
+    std::size_t size() const { return capacity; }
+
+private:
+    enum State { Empty, Idle, Busy };
+
+    struct Slot {
+        Slot() : state(Empty), lastUsed(0) {}
+
+        std::atomic<int> state;
+        std::atomic<Clock::rep> lastUsed;
+        std::vector<DBConnection> conn;  // 为空表示尚未建立连接
+        char padding[64];                // 避免相邻槽位伪共享
+    };
+
+    bool tryAcquire(std::size_t index, int expected) {
+        return slots[index].state.compare_exchange_strong(
+            expected, Busy, std::memory_order_acquire);
+    }
+
+    bool scan(int expected, std::size_t& index) {
+        for (std::size_t i = 0; i < capacity; ++i) {
+            if (slots[i].state.load(std::memory_order_relaxed) == expected &&
+                tryAcquire(i, expected)) {
+                index = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 交给调用者之前先做健康检查，失效的连接直接重建
+    std::size_t prepare(std::size_t index) {
+        if (!slots[index].conn[0].ping()) {
+            closeQuietly(index);  // 关闭失败也照样重建，槽位不会一直处于 Busy
+            try {
+                slots[index].conn[0] = DBConnection::create();
+            } catch (...) {
+                slots[index].conn.clear();
+                slots[index].state.store(Empty, std::memory_order_release);
+                throw;
+            }
+        }
+        lastSlot = index;
+        return index;
+    }
+
+    // 吞下 close 抛出的异常并记录下来，和 DBConn 的析构函数一样
+    void closeQuietly(std::size_t index) {
+        try {
+            slots[index].conn[0].close();
+        } catch (...) {
+            std::cout << "close fail!" << std::endl;
+        }
+    }
+
+    void closeSlot(std::size_t index) {
+        closeQuietly(index);
+        slots[index].conn.clear();
+        slots[index].state.store(Empty, std::memory_order_release);
+    }
+
+    DBConnectionPool(const DBConnectionPool&);
+    DBConnectionPool& operator=(const DBConnectionPool&);
+
+    std::size_t capacity;
+    Slot* slots;
+
+    static thread_local std::size_t lastSlot;
+};
+
+thread_local std::size_t DBConnectionPool::lastSlot =
+    static_cast<std::size_t>(-1);
+
+// DBConn 不再持有自己的连接，而是从连接池借出，析构时归还而不是关闭
+class DBConn {
+public:
+    explicit DBConn(DBConnectionPool& pool_,
+                    std::chrono::milliseconds timeout = std::chrono::seconds(1))
+        : pool(pool_), index(pool_.checkout(timeout)), released(false) {}
+
+    DBConnection& connection() { return pool.get(index); }
+
+    void close() {
+        if (released) return;  // 重复调用不能把槽位归还两次
+        pool.release(index);
+        released = true;
+    }
+
+    ~DBConn() {
+        if (!released) pool.release(index);  // release 不会抛出异常
+    }
+
+private:
+    DBConn(const DBConn&);
+    DBConn& operator=(const DBConn&);
+
+    DBConnectionPool& pool;
+    std::size_t index;
+    bool released;
+};
+
+template <typename F>
+double runThreads(int threads, F f) {
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) workers.push_back(std::thread(f));
+    for (std::size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+int main() {
+    const int threads = 4;
+    const int requests = 100;
+
+    double direct = runThreads(threads, [] {
+        for (int i = 0; i < requests; ++i) {
+            DBConnection db = DBConnection::create();
+            db.close();
+        }
+    });
+    std::cout << "create per scope: " << direct << " ms, "
+              << DBConnection::created << " connections created" << std::endl;
+
+    DBConnection::created = 0;
+    DBConnection::closed = 0;
+    {
+        DBConnectionPool pool(threads);
+        double pooled = runThreads(threads, [&pool] {
+            for (int i = 0; i < requests; ++i) {
+                DBConn dbc(pool);
+                dbc.connection().ping();
+            }  // dbc 析构时把连接归还给连接池
+        });
+        std::cout << "pooled:           " << pooled << " ms, "
+                  << DBConnection::created << " connections created"
+                  << std::endl;
+
+        // 失效的连接会在下一次 checkout 时被重建
+        {
+            DBConn dbc(pool);
+            dbc.connection().markBroken();
+        }
+        {
+            DBConn dbc(pool);
+            std::cout << "healthy after checkout: " << dbc.connection().ping()
+                      << std::endl;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::cout << "evicted idle connections: "
+                  << pool.evictIdle(std::chrono::milliseconds(10)) << std::endl;
+    }
+    std::cout << "pool created: " << DBConnection::created
+              << ", pool closed: " << DBConnection::closed << std::endl;
+
+    return 0;
+}
\ No newline at end of file
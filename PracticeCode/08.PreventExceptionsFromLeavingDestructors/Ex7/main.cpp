@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// 用于测试的 DBConnection 替身：close 需要一定的时间，且编号为 5 的倍数的连接
+// 第一次 close 会失败
+class DBConnection {
+public:
+    static DBConnection create() {
+        DBConnection db(nextId++);
+        return db;
+    };
+
+    void close() {
+        std::this_thread::sleep_for(closeLatency);
+        if (id % 5 == 0 && attempts++ == 0) {
+            throw std::runtime_error("close error");
+        }
+    }
+
+    static std::chrono::microseconds closeLatency;
+
+private:
+    explicit DBConnection(int id_) : id(id_), attempts(0) {}
+
+    int id;
+    int attempts;
+
+    static std::atomic<int> nextId;
+};
+
+std::chrono::microseconds DBConnection::closeLatency(500);
+std::atomic<int> DBConnection::nextId(0);
+
+// 后台关闭连接的回收线程。
+// enqueue 把连接压入一个无锁栈（多生产者），回收线程每次用 exchange 取走整个
+// 栈，因此不存在 ABA 问题。关闭失败的连接按指数退避重试，超过次数后记为失败。
+class CloseReaper {
+public:
+    explicit CloseReaper(int maxAttempts_ = 4,
+                         std::chrono::milliseconds baseBackoff_ =
+                             std::chrono::milliseconds(1))
+        : maxAttempts(maxAttempts_),
+          baseBackoff(baseBackoff_),
+          head(0),
+          stopping(false),
+          pendingCount(0),
+          closedCount(0),
+          failedCount(0),
+          retriedCount(0),
+          worker(&CloseReaper::run, this) {}
+
+    // 析构时保证队列中的连接全部处理完毕（成功或最终失败）
+    ~CloseReaper() {
+        stopping.store(true, std::memory_order_release);
+        worker.join();
+    }
+
+    // 只分配一个节点并做一次 CAS，不会阻塞调用者
+    void enqueue(const DBConnection& db) {
+        Node* node = new Node(db);
+        pendingCount.fetch_add(1, std::memory_order_relaxed);
+        node->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(node->next, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        }
+    }
+
+    long pending() const { return pendingCount.load(); }
+    long closed() const { return closedCount.load(); }
+    long failed() const { return failedCount.load(); }
+    long retried() const { return retriedCount.load(); }
+
+private:
+    struct Node {
+        explicit Node(const DBConnection& db_)
+            : db(db_), next(0), attempts(0), retryAt() {}
+
+        DBConnection db;
+        Node* next;
+        int attempts;
+        Clock::time_point retryAt;
+    };
+
+    void run() {
+        std::vector<Node*> batch;
+        std::vector<Node*> retries;
+        for (;;) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            Node* list = head.exchange(0, std::memory_order_acquire);
+            for (; list; list = list->next) batch.push_back(list);
+            std::reverse(batch.begin(), batch.end());  // 按入队顺序关闭
+
+            Clock::time_point now = Clock::now();
+            for (std::size_t i = 0; i < retries.size();) {
+                if (stop || retries[i]->retryAt <= now) {
+                    batch.push_back(retries[i]);
+                    retries[i] = retries.back();
+                    retries.pop_back();
+                } else {
+                    ++i;
+                }
+            }
+
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                if (!closeOne(batch[i])) retries.push_back(batch[i]);
+            }
+            bool idle = batch.empty();
+            batch.clear();
+
+            if (stop && retries.empty() &&
+                head.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+            if (idle) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+    }
+
+    // 返回 false 表示需要稍后重试
+    bool closeOne(Node* node) {
+        try {
+            node->db.close();
+            closedCount.fetch_add(1, std::memory_order_relaxed);
+        } catch (...) {
+            if (++node->attempts < maxAttempts) {
+                retriedCount.fetch_add(1, std::memory_order_relaxed);
+                node->retryAt = Clock::now() +
+                                baseBackoff * (1 << (node->attempts - 1));
+                return false;
+            }
+            failedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        pendingCount.fetch_sub(1, std::memory_order_relaxed);
+        delete node;
+        return true;
+    }
+
+    CloseReaper(const CloseReaper&);
+    CloseReaper& operator=(const CloseReaper&);
+
+    const int maxAttempts;
+    const std::chrono::milliseconds baseBackoff;
+    std::atomic<Node*> head;
+    std::atomic<bool> stopping;
+    std::atomic<long> pendingCount;
+    std::atomic<long> closedCount;
+    std::atomic<long> failedCount;
+    std::atomic<long> retriedCount;
+    std::thread worker;
+};
+
+class DBConn {
+public:
+    // reaper 为空时保持原来的同步关闭行为
+    DBConn(DBConnection db_, CloseReaper* reaper_ = 0)
+        : db(db_), reaper(reaper_), closed(false) {}
+
+    // 需要得知关闭结果的调用者仍然可以显式调用 close 并处理异常
+    void close() {
+        db.close();
+        closed = true;
+    }
+
+    ~DBConn() {
+        if (closed) return;
+        try {
+            if (reaper) {
+                reaper->enqueue(db);  // 交给后台线程关闭，不阻塞调用者
+            } else {
+                db.close();
+            }
+        } catch (...) {
+            std::cout << "close fail!" << std::endl;
+        }
+    }
+
+private:
+    DBConnection db;
+    CloseReaper* reaper;
+    bool closed;
+};
+
+double destroyMany(int n, CloseReaper* reaper) {
+    double worst = 0;
+    for (int i = 0; i < n; ++i) {
+        DBConn* dbc = new DBConn(DBConnection::create(), reaper);
+        Clock::time_point start = Clock::now();
+        delete dbc;
+        double us = std::chrono::duration<double, std::micro>(Clock::now() -
+                                                              start)
+                        .count();
+        worst = std::max(worst, us);
+    }
+    return worst;
+}
+
+int main() {
+    const int n = 50;
+
+    double syncWorst = destroyMany(n, 0);
+    std::cout << "synchronous close, worst destructor time: " << syncWorst
+              << " us" << std::endl;
+
+    {
+        CloseReaper reaper;
+        std::cout << "reaper close, worst destructor time: "
+                  << destroyMany(n, &reaper) << " us" << std::endl;
+        std::cout << "pending right after destruction: " << reaper.pending()
+                  << std::endl;
+
+        while (reaper.pending() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::cout << "closed: " << reaper.closed()
+                  << ", retried: " << reaper.retried()
+                  << ", failed: " << reaper.failed() << std::endl;
+    }
+
+    // 显式 close 的调用者可以自己处理错误
+    DBConn dbc(DBConnection::create());
+    try {
+        dbc.close();
+    } catch (const std::exception& e) {
+        std::cout << "explicit close failed: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
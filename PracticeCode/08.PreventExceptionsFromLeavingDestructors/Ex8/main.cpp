@@ -0,0 +1,319 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 协议：每一帧为 [uint32 请求编号][uint32 长度][负载]，请求和响应格式相同，
+// 响应通过请求编号与请求对应，因此服务端可以乱序返回。
+
+namespace wire {
+
+void append(std::string& buf, uint32_t id, const std::string& payload) {
+    uint32_t header[2] = {id, static_cast<uint32_t>(payload.size())};
+    buf.append(reinterpret_cast<const char*>(header), sizeof(header));
+    buf.append(payload);
+}
+
+// 从 buf 头部解析出一帧，数据不完整时返回 false
+bool parse(std::string& buf, uint32_t& id, std::string& payload) {
+    uint32_t header[2];
+    if (buf.size() < sizeof(header)) return false;
+    std::memcpy(header, buf.data(), sizeof(header));
+    if (buf.size() < sizeof(header) + header[1]) return false;
+    id = header[0];
+    payload.assign(buf, sizeof(header), header[1]);
+    buf.erase(0, sizeof(header) + header[1]);
+    return true;
+}
+
+// 用 send 加 MSG_NOSIGNAL：对端已关闭时返回 EPIPE 而不是产生 SIGPIPE 杀死进程
+void writeAll(int fd, const std::string& buf) {
+    std::size_t done = 0;
+    while (done < buf.size()) {
+        ssize_t n = ::send(fd, buf.data() + done, buf.size() - done,
+                           MSG_NOSIGNAL);
+        if (n < 0) throw std::runtime_error("write failed");
+        done += n;
+    }
+}
+
+// 读取一次（可能包含多帧），对端关闭时返回 false
+bool readSome(int fd, std::string& buf) {
+    char chunk[64 * 1024];
+    ssize_t n = ::read(fd, chunk, sizeof(chunk));
+    if (n < 0) throw std::runtime_error("read failed");
+    buf.append(chunk, n);
+    return n > 0;
+}
+
+}  // namespace wire
+
+// 本地 Unix socket 替身服务端：每次读到的一批请求按相反顺序应答，用于验证
+// 客户端能正确处理乱序完成
+class StandInServer {
+public:
+    explicit StandInServer(const std::string& path_) : path(path_) {
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = address(path);
+        ::unlink(path.c_str());
+        if (listenFd < 0 ||
+            ::bind(listenFd, reinterpret_cast<sockaddr*>(&addr),
+                   sizeof(addr)) < 0 ||
+            ::listen(listenFd, 16) < 0) {
+            throw std::runtime_error("StandInServer: cannot listen");
+        }
+        acceptor = std::thread(&StandInServer::acceptLoop, this);
+    }
+
+    ~StandInServer() {
+        ::shutdown(listenFd, SHUT_RDWR);  // 唤醒阻塞在 accept 上的线程
+        acceptor.join();
+        for (std::size_t i = 0; i < handlers.size(); ++i) handlers[i].join();
+        ::close(listenFd);
+        ::unlink(path.c_str());
+    }
+
+    static sockaddr_un address(const std::string& path) {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        return addr;
+    }
+
+private:
+    void acceptLoop() {
+        for (;;) {
+            int fd = ::accept(listenFd, 0, 0);
+            if (fd < 0) return;
+            handlers.push_back(std::thread(&StandInServer::serve, fd));
+        }
+    }
+
+    // 线程函数中的异常不能逃出去，否则会调用 std::terminate
+    static void serve(int fd) {
+        std::string in, out, payload;
+        uint32_t id;
+        std::vector<std::pair<uint32_t, std::string> > batch;
+        try {
+            while (wire::readSome(fd, in)) {
+                while (wire::parse(in, id, payload)) {
+                    batch.push_back(std::make_pair(id, "value of " + payload));
+                }
+                std::reverse(batch.begin(), batch.end());
+                for (std::size_t i = 0; i < batch.size(); ++i) {
+                    wire::append(out, batch[i].first, batch[i].second);
+                }
+                batch.clear();
+                wire::writeAll(fd, out);  // 一批响应一次写出
+                out.clear();
+            }
+        } catch (const std::exception&) {
+            // 客户端提前断开，丢弃未发出的响应
+        }
+        ::close(fd);
+    }
+
+    std::string path;
+    int listenFd;
+    std::thread acceptor;
+    std::vector<std::thread> handlers;
+};
+
+// 支持流水线的 DBConnection：submit 只把请求追加到写缓冲区，小请求攒够一批
+// 或者有人等待结果时才真正写出；wait 读取响应直到拿到指定编号的结果，
+// 先到达的其它响应暂存起来。
+class DBConnection {
+public:
+    static DBConnection create(const std::string& path) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = StandInServer::address(path);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr),
+                                sizeof(addr)) < 0) {
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error("DBConnection: cannot connect");
+        }
+        return DBConnection(fd);
+    };
+
+    DBConnection(DBConnection&& rhs)
+        : fd(rhs.fd),
+          nextId(rhs.nextId),
+          outgoing(std::move(rhs.outgoing)),
+          incoming(std::move(rhs.incoming)),
+          waiting(std::move(rhs.waiting)),
+          completed(std::move(rhs.completed)) {
+        rhs.fd = -1;
+    }
+
+    ~DBConnection() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    // 发出一个请求，返回请求编号
+    uint32_t submit(const std::string& request) {
+        uint32_t id = nextId++;
+        waiting.insert(id);
+        wire::append(outgoing, id, request);
+        if (outgoing.size() >= kBatchBytes) flush();
+        return id;
+    }
+
+    void flush() {
+        while (!outgoing.empty()) pump();
+    }
+
+    // 等待指定请求的响应。编号没有发出过或者结果已经取走时抛出异常，
+    // 否则会一直等待一个不会到达的响应
+    std::string wait(uint32_t id) {
+        if (id >= nextId) {
+            throw std::invalid_argument("DBConnection: unknown request id");
+        }
+        if (waiting.erase(id) == 0) {
+            throw std::invalid_argument("DBConnection: result already taken");
+        }
+        std::map<uint32_t, std::string>::iterator it;
+        while ((it = completed.find(id)) == completed.end()) pump();
+        std::string result;
+        result.swap(it->second);
+        completed.erase(it);
+        return result;
+    }
+
+    // 一问一答的同步接口
+    std::string request(const std::string& req) { return wait(submit(req)); }
+
+    void close() {
+        if (fd < 0) return;
+        flush();
+        int rc = ::close(fd);
+        fd = -1;
+        if (rc < 0) throw std::runtime_error("close error");
+    }
+
+private:
+    static const std::size_t kBatchBytes = 16 * 1024;
+
+    explicit DBConnection(int fd_) : fd(fd_), nextId(0) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    // 同时处理读写：写缓冲区里还有数据时尽量写出，有响应到达时就读进来。
+    // 如果只写不读，双方的 socket 缓冲区都写满后会互相等待而死锁。
+    void pump() {
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN | (outgoing.empty() ? 0 : POLLOUT);
+        if (::poll(&pfd, 1, -1) < 0) throw std::runtime_error("poll failed");
+        if (pfd.revents & POLLOUT) {
+            ssize_t n = ::send(fd, outgoing.data(), outgoing.size(),
+                               MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN) {
+                throw std::runtime_error("write failed");
+            }
+            if (n > 0) outgoing.erase(0, n);
+        }
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            char chunk[64 * 1024];
+            ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n == 0) {
+                throw std::runtime_error("DBConnection: server closed");
+            }
+            if (n < 0 && errno != EAGAIN) {
+                throw std::runtime_error("read failed");
+            }
+            if (n > 0) incoming.append(chunk, n);
+            uint32_t doneId;
+            std::string payload;
+            while (wire::parse(incoming, doneId, payload)) {
+                completed[doneId].swap(payload);
+            }
+        }
+    }
+
+    DBConnection(const DBConnection&);
+    DBConnection& operator=(const DBConnection&);
+
+    int fd;
+    uint32_t nextId;
+    std::string outgoing;
+    std::string incoming;
+    std::set<uint32_t> waiting;  // 已发出、结果还没被取走的请求
+    std::map<uint32_t, std::string> completed;
+};
+
+class DBConn {
+public:
+    DBConn(DBConnection db_) : db(std::move(db_)), closed(false) {}
+
+    DBConnection& connection() { return db; }
+
+    void close() {
+        db.close();
+        closed = true;
+    }
+
+    ~DBConn() {
+        if (!closed) {
+            try {
+                db.close();
+            } catch (...) {
+                std::cout << "close fail!" << std::endl;
+            }
+        }
+    }
+
+private:
+    DBConnection db;
+    bool closed;
+};
+
+int main() {
+    typedef std::chrono::steady_clock Clock;
+    const int n = 20000;
+    StandInServer server("/tmp/effective-cpp-item08-ex8.sock");
+
+    DBConn dbc(DBConnection::create("/tmp/effective-cpp-item08-ex8.sock"));
+    DBConnection& db = dbc.connection();
+    std::cout << db.request("key0") << std::endl;
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < n; ++i) db.request("key");
+    double serial =
+        std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < n; ++i) ids.push_back(db.submit("key"));
+    bool ok = true;
+    for (int i = n - 1; i >= 0; --i) ok &= db.wait(ids[i]) == "value of key";
+    double pipelined =
+        std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << n << " requests, one at a time: " << serial << " ms"
+              << std::endl;
+    std::cout << n << " requests, pipelined:     " << pipelined << " ms"
+              << (ok ? "" : " (mismatched response!)") << std::endl;
+
+    try {
+        db.wait(ids[0]);
+    } catch (const std::invalid_argument& e) {
+        std::cout << "exception caught: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
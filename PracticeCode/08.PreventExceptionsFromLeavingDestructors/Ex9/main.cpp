@@ -0,0 +1,640 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 一个嵌入式的内存存储引擎，供 DBConnection 在进程内使用。
+//
+// - 数据按 key 的哈希值分到若干个 shard，每个 shard 有自己的写锁和哈希索引
+// - 每个 shard 的数据都追加写入自己的日志段（LogSegment），写入后不再修改
+// - 同一个 key 的多个版本串成链表，读操作按快照版本号沿链表查找（MVCC），
+//   全程只有 acquire 读，不加锁，因此读者永远不会阻塞写者
+// - 后台线程定期压缩垃圾较多的 shard：把仍然可见的版本复制到新的日志段，
+//   原子地切换过去，旧日志段等所有可能还在读它的读者离开后再释放
+
+namespace storage {
+
+// 只追加的日志段：按块分配内存，已写入的记录地址永不改变
+class LogSegment {
+public:
+    LogSegment() : used(kChunkSize), bytes(0) {}
+
+    ~LogSegment() {
+        for (std::size_t i = 0; i < chunks.size(); ++i) delete[] chunks[i];
+    }
+
+    // 一条记录在日志中实际占用的字节数（按 8 字节对齐）
+    static std::size_t alignedSize(std::size_t size) {
+        return (size + 7) & ~static_cast<std::size_t>(7);
+    }
+
+    void* append(std::size_t size) {
+        size = alignedSize(size);
+        bytes += size;
+        if (size > kChunkSize / 4) {  // 大记录单独占一个块
+            chunks.push_back(new char[size]);
+            return chunks.back();
+        }
+        if (used + size > kChunkSize) {
+            chunks.push_back(new char[kChunkSize]);
+            used = 0;
+        }
+        void* p = chunks.back() + used;
+        used += size;
+        return p;
+    }
+
+    std::size_t size() const { return bytes; }
+
+private:
+    static const std::size_t kChunkSize = 1 << 20;
+
+    LogSegment(const LogSegment&);
+    LogSegment& operator=(const LogSegment&);
+
+    std::vector<char*> chunks;
+    std::size_t used;
+    std::size_t bytes;
+};
+
+// 同一个 key 的一个版本
+struct Record {
+    uint64_t version;
+    const Record* older;
+    uint32_t size;
+    bool deleted;
+    char value[1];
+};
+
+// 索引中的一个 key，latest 指向最新版本
+struct KeyNode {
+    KeyNode* next;  // 同一个桶中的下一个 key
+    std::atomic<const Record*> latest;
+    uint64_t hash;
+    uint32_t size;
+    char key[1];
+
+    bool matches(uint64_t h, const std::string& k) const {
+        return hash == h && size == k.size() &&
+               std::memcmp(key, k.data(), size) == 0;
+    }
+};
+
+// 一个 shard 的完整状态。压缩时整体替换
+struct ShardState {
+    explicit ShardState(std::size_t buckets_)
+        : buckets(new std::atomic<KeyNode*>[buckets_]),
+          bucketCount(buckets_),
+          liveBytes(0) {
+        for (std::size_t i = 0; i < bucketCount; ++i) buckets[i].store(0);
+    }
+
+    ~ShardState() { delete[] buckets; }
+
+    std::atomic<KeyNode*>* buckets;  // 桶数固定，不做 rehash
+    std::size_t bucketCount;
+    // 每个 key 的 KeyNode 和最新版本在日志中占用的字节数
+    std::size_t liveBytes;
+    LogSegment log;
+};
+
+class StorageEngine;
+
+// 快照：持有期间看到的数据不会改变
+class Snapshot {
+public:
+    ~Snapshot();
+    uint64_t version() const { return m_version; }
+
+private:
+    friend class StorageEngine;
+    Snapshot(StorageEngine& engine_, std::size_t slot_, uint64_t version_)
+        : engine(engine_), slot(slot_), m_version(version_) {}
+    Snapshot(const Snapshot&);
+    Snapshot& operator=(const Snapshot&);
+
+    StorageEngine& engine;
+    std::size_t slot;
+    uint64_t m_version;
+};
+
+class StorageEngine {
+public:
+    struct Options {
+        Options()
+            : shards(16),
+              bucketsPerShard(1 << 16),
+              compactionInterval(std::chrono::milliseconds(50)),
+              garbageRatio(0.5) {}
+
+        std::size_t shards;
+        std::size_t bucketsPerShard;
+        std::chrono::milliseconds compactionInterval;
+        double garbageRatio;  // 垃圾占比超过该值时压缩
+    };
+
+    explicit StorageEngine(const Options& options_ = Options())
+        : options(options_),
+          shards(options_.shards),
+          nextVersion(1),
+          committed(1),
+          floor(0),
+          compactions(0),
+          stopping(false) {
+        for (std::size_t i = 0; i < shards.size(); ++i) {
+            shards[i].state.store(new ShardState(options.bucketsPerShard));
+        }
+        compactor = std::thread(&StorageEngine::compactLoop, this);
+    }
+
+    ~StorageEngine() {
+        stopping.store(true);
+        compactor.join();
+        for (std::size_t i = 0; i < retired.size(); ++i) {
+            delete retired[i].state;
+        }
+        for (std::size_t i = 0; i < shards.size(); ++i) delete shards[i].state;
+    }
+
+    void put(const std::string& key, const std::string& value) {
+        write(key, value.data(), value.size(), false);
+    }
+
+    void erase(const std::string& key) { write(key, 0, 0, true); }
+
+    // 读取最新提交的数据
+    bool get(const std::string& key, std::string& value) {
+        std::size_t slot = pin();
+        bool found = lookup(key, slots[slot].version.load(), value);
+        unpin(slot);
+        return found;
+    }
+
+    // 在快照上读取
+    bool get(const Snapshot& snap, const std::string& key,
+             std::string& value) const {
+        return lookup(key, snap.version(), value);
+    }
+
+    // 析构时注销读者，旧版本才能被压缩掉
+    std::unique_ptr<Snapshot> snapshot() {
+        std::size_t slot = pin();
+        return std::unique_ptr<Snapshot>(
+            new Snapshot(*this, slot, slots[slot].version.load()));
+    }
+
+    // 立即压缩所有 shard，返回回收的字节数
+    std::size_t compact() {
+        std::size_t reclaimed = 0;
+        for (std::size_t i = 0; i < shards.size(); ++i) {
+            reclaimed += compactShard(i, 0.0);
+        }
+        std::lock_guard<std::mutex> lock(retireMutex);
+        reclaimRetired();
+        return reclaimed;
+    }
+
+    std::size_t compactionCount() const { return compactions.load(); }
+
+    std::size_t logBytes() const {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < shards.size(); ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].writeMutex);
+            total += shards[i].state.load()->log.size();
+        }
+        return total;
+    }
+
+private:
+    friend class Snapshot;
+
+    static const std::size_t kSlots = 256;
+
+    struct Shard {
+        Shard() : state(0) {}
+        std::atomic<ShardState*> state;
+        mutable std::mutex writeMutex;
+        char padding[64];
+    };
+
+    // 读者登记槽：version 为 0 表示空闲，否则为该读者使用的快照版本
+    struct Slot {
+        Slot() : used(false), version(0), seq(0) {}
+        std::atomic<bool> used;
+        std::atomic<uint64_t> version;
+        std::atomic<uint64_t> seq;  // 每次离开加一，用于判断读者是否已离开
+        char padding[64];
+    };
+
+    struct Retired {
+        ShardState* state;
+        std::vector<std::pair<std::size_t, uint64_t> > readers;
+    };
+
+    static uint64_t hashOf(const std::string& key) {
+        return std::hash<std::string>()(key) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    Shard& shardFor(uint64_t h) { return shards[h % shards.size()]; }
+
+    // 登记一个读者并取得快照版本
+    std::size_t pin() {
+        static thread_local std::size_t hint = 0;
+        std::size_t slot = hint;
+        for (std::size_t i = 0;; ++i, slot = (slot + 1) % kSlots) {
+            bool expected = false;
+            if (!slots[slot].used.load(std::memory_order_relaxed) &&
+                slots[slot].used.compare_exchange_strong(expected, true)) {
+                break;
+            }
+            if (i >= kSlots) std::this_thread::yield();
+        }
+        hint = slot;
+        for (;;) {
+            uint64_t v = committed.load();
+            slots[slot].version.store(v);
+            // 若压缩线程已经按更新的版本下限压缩，重新取版本号
+            if (v >= floor.load()) break;
+        }
+        return slot;
+    }
+
+    void unpin(std::size_t slot) {
+        slots[slot].version.store(0);
+        slots[slot].seq.fetch_add(1);
+        slots[slot].used.store(false, std::memory_order_release);
+    }
+
+    bool lookup(const std::string& key, uint64_t snap,
+                std::string& value) const {
+        uint64_t h = hashOf(key);
+        const ShardState* state = shards[h % shards.size()].state.load();
+        KeyNode* node =
+            state->buckets[(h >> 16) % state->bucketCount].load(
+                std::memory_order_acquire);
+        for (; node; node = node->next) {
+            if (!node->matches(h, key)) continue;
+            const Record* r = node->latest.load(std::memory_order_acquire);
+            while (r && r->version > snap) r = r->older;
+            if (!r || r->deleted) return false;
+            value.assign(r->value, r->size);
+            return true;
+        }
+        return false;
+    }
+
+    // 与 LogSegment::append 的计算方式一致，liveBytes 才能和 log.size() 比较
+    static std::size_t recordBytes(std::size_t size) {
+        return LogSegment::alignedSize(offsetof(Record, value) + size);
+    }
+
+    static std::size_t keyNodeBytes(std::size_t size) {
+        return LogSegment::alignedSize(offsetof(KeyNode, key) + size);
+    }
+
+    static Record* newRecord(LogSegment& log, const char* data,
+                             std::size_t size) {
+        Record* r = static_cast<Record*>(
+            log.append(offsetof(Record, value) + size));
+        r->size = static_cast<uint32_t>(size);
+        if (size) std::memcpy(r->value, data, size);
+        return r;
+    }
+
+    static KeyNode* findOrInsert(ShardState& state, uint64_t h,
+                                 const char* key, std::size_t size) {
+        std::atomic<KeyNode*>& bucket =
+            state.buckets[(h >> 16) % state.bucketCount];
+        KeyNode* head = bucket.load(std::memory_order_relaxed);
+        for (KeyNode* n = head; n; n = n->next) {
+            if (n->hash == h && n->size == size &&
+                std::memcmp(n->key, key, size) == 0) {
+                return n;
+            }
+        }
+        KeyNode* node = static_cast<KeyNode*>(
+            state.log.append(offsetof(KeyNode, key) + size));
+        node->next = head;
+        new (&node->latest) std::atomic<const Record*>(0);
+        node->hash = h;
+        node->size = static_cast<uint32_t>(size);
+        std::memcpy(node->key, key, size);
+        bucket.store(node, std::memory_order_release);
+        return node;
+    }
+
+    void write(const std::string& key, const char* data, std::size_t size,
+               bool deleted) {
+        uint64_t h = hashOf(key);
+        uint64_t v;
+        {
+            Shard& shard = shardFor(h);
+            std::lock_guard<std::mutex> lock(shard.writeMutex);
+            ShardState& state = *shard.state.load();
+            KeyNode* node = findOrInsert(state, h, key.data(), key.size());
+            Record* r = newRecord(state.log, data, size);
+            const Record* prev = node->latest.load(std::memory_order_relaxed);
+            r->older = prev;
+            r->deleted = deleted;
+            // 版本号在持有 shard 写锁时分配，保证同一个 key 的版本链单调递减
+            v = nextVersion.fetch_add(1) + 1;
+            r->version = v;
+            node->latest.store(r, std::memory_order_release);
+            if (prev) {
+                state.liveBytes -= recordBytes(prev->size);
+            } else {  // 新插入的 key
+                state.liveBytes += keyNodeBytes(key.size());
+            }
+            state.liveBytes += recordBytes(size);
+        }
+        // 按版本号顺序提交：读者拿到的快照版本之前的写入一定都已发布
+        while (committed.load(std::memory_order_acquire) != v - 1) {
+            std::this_thread::yield();
+        }
+        committed.store(v, std::memory_order_release);
+    }
+
+    // 当前仍被读者使用的最老版本
+    uint64_t oldestVisible() {
+        uint64_t oldest = committed.load();
+        floor.store(oldest);
+        for (std::size_t i = 0; i < kSlots; ++i) {
+            uint64_t v = slots[i].version.load();
+            if (v != 0 && v < oldest) oldest = v;
+        }
+        return oldest;
+    }
+
+    std::size_t compactShard(std::size_t index, double garbageRatio) {
+        Shard& shard = shards[index];
+        std::lock_guard<std::mutex> lock(shard.writeMutex);
+        ShardState* old = shard.state.load();
+        std::size_t total = old->log.size();
+        if (total == 0 ||
+            old->liveBytes >= total * (1.0 - garbageRatio)) {
+            return 0;
+        }
+
+        uint64_t oldest = oldestVisible();
+        ShardState* fresh = new ShardState(old->bucketCount);
+        std::vector<const Record*> keep;
+        for (std::size_t b = 0; b < old->bucketCount; ++b) {
+            for (KeyNode* n = old->buckets[b].load(); n; n = n->next) {
+                // 保留比 oldest 新的版本，以及 oldest 时可见的那个版本
+                keep.clear();
+                for (const Record* r = n->latest.load(); r; r = r->older) {
+                    keep.push_back(r);
+                    if (r->version <= oldest) break;
+                }
+                if (keep.size() == 1 && keep[0]->deleted) continue;
+
+                KeyNode* copy = findOrInsert(*fresh, n->hash, n->key, n->size);
+                const Record* chain = 0;
+                for (std::size_t k = keep.size(); k-- > 0;) {
+                    Record* r = newRecord(fresh->log, keep[k]->value,
+                                          keep[k]->size);
+                    r->version = keep[k]->version;
+                    r->deleted = keep[k]->deleted;
+                    r->older = chain;
+                    chain = r;
+                }
+                copy->latest.store(chain, std::memory_order_release);
+                fresh->liveBytes +=
+                    keyNodeBytes(n->size) + recordBytes(keep[0]->size);
+            }
+        }
+        shard.state.store(fresh);
+        compactions.fetch_add(1);
+
+        // 记录切换时刻所有在读的读者，它们都离开后旧状态才能释放
+        Retired r;
+        r.state = old;
+        for (std::size_t i = 0; i < kSlots; ++i) {
+            if (slots[i].version.load() != 0) {
+                r.readers.push_back(std::make_pair(i, slots[i].seq.load()));
+            }
+        }
+        std::lock_guard<std::mutex> retireLock(retireMutex);
+        retired.push_back(r);
+        return total - fresh->log.size();
+    }
+
+    // 调用者需持有 retireMutex
+    void reclaimRetired() {
+        for (std::size_t i = 0; i < retired.size();) {
+            bool busy = false;
+            for (std::size_t k = 0; k < retired[i].readers.size(); ++k) {
+                std::size_t slot = retired[i].readers[k].first;
+                if (slots[slot].seq.load() == retired[i].readers[k].second) {
+                    busy = true;
+                    break;
+                }
+            }
+            if (busy) {
+                ++i;
+            } else {
+                delete retired[i].state;
+                retired[i] = retired.back();
+                retired.pop_back();
+            }
+        }
+    }
+
+    void compactLoop() {
+        while (!stopping.load()) {
+            std::this_thread::sleep_for(options.compactionInterval);
+            for (std::size_t i = 0; i < shards.size() && !stopping.load();
+                 ++i) {
+                compactShard(i, options.garbageRatio);
+            }
+            std::lock_guard<std::mutex> lock(retireMutex);
+            reclaimRetired();
+        }
+    }
+
+    StorageEngine(const StorageEngine&);
+    StorageEngine& operator=(const StorageEngine&);
+
+    Options options;
+    std::vector<Shard> shards;
+    Slot slots[kSlots];
+    std::atomic<uint64_t> nextVersion;
+    std::atomic<uint64_t> committed;  // 该版本及之前的写入都已对读者可见
+    std::atomic<uint64_t> floor;
+    std::atomic<std::size_t> compactions;
+    std::atomic<bool> stopping;
+    std::mutex retireMutex;
+    std::vector<Retired> retired;
+    std::thread compactor;
+};
+
+Snapshot::~Snapshot() { engine.unpin(slot); }
+
+}  // namespace storage
+
+// DBConnection 通过进程内的存储引擎访问数据
+class DBConnection {
+public:
+    static DBConnection create(storage::StorageEngine& engine) {
+        DBConnection db(engine);
+        return db;
+    };
+
+    void put(const std::string& key, const std::string& value) {
+        engine->put(key, value);
+    }
+
+    bool get(const std::string& key, std::string& value) {
+        return engine->get(key, value);
+    }
+
+    void erase(const std::string& key) { engine->erase(key); }
+
+    void close() {}
+
+private:
+    explicit DBConnection(storage::StorageEngine& engine_)
+        : engine(&engine_) {}
+
+    storage::StorageEngine* engine;
+};
+
+class DBConn {
+public:
+    DBConn(DBConnection db_) : db(db_), closed(false) {}
+
+    DBConnection& connection() { return db; }
+
+    void close() {
+        db.close();
+        closed = true;
+    }
+
+    ~DBConn() {
+        if (!closed) {
+            try {
+                db.close();
+            } catch (...) {
+                std::cout << "close fail!" << std::endl;
+            }
+        }
+    }
+
+private:
+    DBConnection db;
+    bool closed;
+};
+
+// 吞吐量与延迟测试：每个线程按 readPercent 的比例随机读写
+void benchmark(storage::StorageEngine& engine, int threads, int readPercent,
+               std::chrono::milliseconds duration) {
+    typedef std::chrono::steady_clock Clock;
+    const int keys = 100000;
+    std::atomic<bool> stop(false);
+    std::atomic<long> ops(0);
+    std::vector<std::vector<double> > samples(threads);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&, t] {
+            DBConn dbc(DBConnection::create(engine));
+            DBConnection& db = dbc.connection();
+            uint64_t rng = 88172645463325252ULL + t;
+            std::string key, value;
+            long n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                rng ^= rng << 13;
+                rng ^= rng >> 7;
+                rng ^= rng << 17;
+                key = "key" + std::to_string(rng % keys);
+                bool sample = (n & 63) == 0;  // 每 64 次操作采样一次延迟
+                Clock::time_point start;
+                if (sample) start = Clock::now();
+                if (static_cast<int>(rng % 100) < readPercent) {
+                    db.get(key, value);
+                } else {
+                    db.put(key, "value" + std::to_string(n));
+                }
+                if (sample) {
+                    std::chrono::duration<double, std::nano> ns =
+                        Clock::now() - start;
+                    samples[t].push_back(ns.count());
+                }
+                ++n;
+            }
+            ops.fetch_add(n);
+        }));
+    }
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (std::size_t t = 0; t < workers.size(); ++t) workers[t].join();
+
+    std::vector<double> all;
+    for (int t = 0; t < threads; ++t) {
+        all.insert(all.end(), samples[t].begin(), samples[t].end());
+    }
+    std::sort(all.begin(), all.end());
+    double seconds = std::chrono::duration<double>(duration).count();
+    std::cout << threads << " threads, " << readPercent << "% reads: "
+              << ops.load() / seconds / 1e6 << " Mops/s, p50 "
+              << all[all.size() / 2] << " ns, p99 "
+              << all[all.size() * 99 / 100] << " ns" << std::endl;
+}
+
+int main() {
+    storage::StorageEngine engine;
+
+    {
+        DBConn dbc(DBConnection::create(engine));
+        DBConnection& db = dbc.connection();
+        std::string value;
+
+        db.put("apple", "1");
+        std::unique_ptr<storage::Snapshot> snap = engine.snapshot();
+        db.put("apple", "2");
+        db.erase("banana");
+
+        engine.get(*snap, "apple", value);
+        std::cout << "apple in snapshot: " << value << std::endl;  // 1
+        db.get("apple", value);
+        std::cout << "apple now: " << value << std::endl;  // 2
+
+        for (int i = 0; i < 1000; ++i) db.put("apple", std::to_string(i));
+        engine.compact();
+        engine.get(*snap, "apple", value);
+        std::cout << "apple in snapshot after compaction: " << value
+                  << std::endl;  // 仍为 1，快照可见的版本不会被压缩掉
+
+        std::size_t before = engine.logBytes();
+        snap.reset();
+        engine.compact();
+        std::cout << "log bytes before/after releasing snapshot: " << before
+                  << "/" << engine.logBytes() << std::endl;
+
+        // 没有写入时后台线程不应该再压缩
+        std::size_t compactions = engine.compactionCount();
+        std::size_t bytes = engine.logBytes();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        std::cout << "idle compactions: "
+                  << engine.compactionCount() - compactions
+                  << ", log bytes unchanged: " << (engine.logBytes() == bytes)
+                  << std::endl;  // 0, 1
+    }
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    benchmark(engine, cores, 90, std::chrono::milliseconds(500));
+    benchmark(engine, cores, 50, std::chrono::milliseconds(500));
+    std::cout << "background compactions: " << engine.compactionCount()
+              << std::endl;
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// 异步日志：调用线程只把一条定长的二进制记录写入自己线程的 SPSC 环形缓冲区，
+// 格式化和写文件都由后台线程批量完成。
+// 只有一个核时后台线程的格式化和写文件与调用线程串行执行，缓冲区满后
+// 调用线程只能等它；多核上这部分开销由另一个核承担。
+// 需要 C++17：over-aligned 的 new[] 才保证 64 字节对齐
+
+// 一条日志记录固定 64 字节，对齐到 cache line，相邻记录不会共享缓存行
+struct alignas(64) LogRecord {
+    int64_t timestamp;  // steady_clock 纳秒
+    int64_t amount;
+    char text[48];
+};
+
+static_assert(sizeof(LogRecord) == 64, "LogRecord must fill one cache line");
+
+// 单生产者单消费者环形缓冲区。head 只由消费者写，tail 只由生产者写
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity)
+        : mask(checkCapacity(capacity) - 1),
+          records(new LogRecord[capacity]) {
+        head.store(0);
+        tail.store(0);
+        cachedHead = 0;
+    }
+
+    ~SpscRing() { delete[] records; }
+
+    // capacity 必须是 2 的幂
+    static std::size_t checkCapacity(std::size_t capacity) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("capacity must be a power of two");
+        }
+        return capacity;
+    }
+
+    bool tryPush(const LogRecord& r) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) return false;  // 已满
+        }
+        records[t & mask] = r;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 取出所有已写入的记录，交给 f 处理，返回取出的条数
+    template <typename F>
+    std::size_t drain(F f) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        for (uint64_t i = h; i != t; ++i) f(records[i & mask]);
+        head.store(t, std::memory_order_release);
+        return t - h;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_acquire);
+    }
+
+private:
+    SpscRing(const SpscRing&);
+    SpscRing& operator=(const SpscRing&);
+
+    const uint64_t mask;
+    LogRecord* records;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    uint64_t cachedHead;  // 生产者缓存的 head，减少跨核读取
+};
+
+class AsyncLogger {
+public:
+    // 环形缓冲区满时的处理方式
+    enum Backpressure {
+        Block,  // 等待后台线程腾出空间
+        Drop,   // 直接丢弃
+        Count   // 丢弃并在日志中写入一条丢弃了多少条记录的提示
+    };
+
+    AsyncLogger(const std::string& path, Backpressure policy_,
+                std::size_t ringCapacity_ = 1 << 14)
+        : policy(policy_),
+          ringCapacity(SpscRing::checkCapacity(ringCapacity_)),
+          file(std::fopen(path.c_str(), "w")),
+          stopping(false),
+          dropped(0),
+          written(0),
+          flushRequests(0),
+          flushesDone(0),
+          id(nextId++) {
+        if (!file) throw std::runtime_error("AsyncLogger: cannot open file");
+        consumer = std::thread(&AsyncLogger::run, this);
+    }
+
+    // 保证析构前提交的所有记录都已写入文件
+    ~AsyncLogger() {
+        stopping.store(true, std::memory_order_release);
+        consumer.join();
+        std::fclose(file);
+    }
+
+    void log(const char* text, int64_t amount) {
+        LogRecord r;
+        r.timestamp = Clock::now().time_since_epoch().count();
+        r.amount = amount;
+        std::size_t len = std::min(std::strlen(text), sizeof(r.text) - 1);
+        std::memcpy(r.text, text, len);
+        r.text[len] = '\0';
+
+        SpscRing& ring = localRing();
+        if (ring.tryPush(r)) return;
+        if (policy == Block) {
+            while (!ring.tryPush(r)) std::this_thread::yield();
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 阻塞直到调用前提交的记录全部写入文件
+    void flush() {
+        uint64_t target = flushRequests.fetch_add(1) + 1;
+        while (flushesDone.load(std::memory_order_acquire) < target) {
+            std::this_thread::yield();
+        }
+    }
+
+    uint64_t droppedCount() const { return dropped.load(); }
+    uint64_t writtenCount() const { return written.load(); }
+
+    // 已注册的环形缓冲区个数
+    std::size_t ringCount() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        return rings.size();
+    }
+
+private:
+    // 每个线程第一次写某个 logger 时为它注册一个环形缓冲区，按 logger 编号
+    // 缓存在线程局部的表中，交替使用多个 logger 也不会重复注册。
+    // 线程退出后缓冲区由后台线程写完剩余记录后释放
+    struct LocalRing {
+        LocalRing() : owner(0) {}
+        uint64_t owner;
+        std::shared_ptr<SpscRing> ring;
+    };
+
+    SpscRing& localRing() {
+        static thread_local std::vector<LocalRing> locals;
+        for (std::size_t i = 0; i < locals.size(); ++i) {
+            if (locals[i].owner == id) return *locals[i].ring;
+        }
+        // 只剩本线程持有的缓冲区属于已经析构的 logger，顺便丢掉
+        for (std::size_t i = 0; i < locals.size();) {
+            if (locals[i].ring.use_count() == 1) {
+                locals[i] = locals.back();
+                locals.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        LocalRing local;
+        local.owner = id;
+        local.ring = std::make_shared<SpscRing>(ringCapacity);
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(local.ring);
+        }
+        locals.push_back(local);
+        return *locals.back().ring;
+    }
+
+
+    void run() {
+        std::string buffer;
+        buffer.reserve(kBatchBytes * 2);
+        std::vector<std::shared_ptr<SpscRing> > snapshot;
+        uint64_t reportedDrops = 0;
+        for (;;) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            uint64_t flushTarget =
+                flushRequests.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                snapshot = rings;
+            }
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < snapshot.size(); ++i) {
+                n += snapshot[i]->drain([&](const LogRecord& r) {
+                    format(buffer, r);
+                    if (buffer.size() >= kBatchBytes) writeOut(buffer);
+                });
+            }
+            written.fetch_add(n, std::memory_order_relaxed);
+
+            uint64_t drops = dropped.load(std::memory_order_relaxed);
+            if (policy == Count && drops != reportedDrops) {
+                char line[64];
+                std::snprintf(line, sizeof(line), "[dropped %llu records]\n",
+                              static_cast<unsigned long long>(drops -
+                                                              reportedDrops));
+                buffer += line;
+                reportedDrops = drops;
+            }
+
+            if (n == 0 || stop || flushTarget > flushesDone.load()) {
+                writeOut(buffer);
+                std::fflush(file);
+                flushesDone.store(flushTarget, std::memory_order_release);
+            }
+            snapshot.clear();
+            releaseFinishedRings();
+            if (stop && n == 0) return;  // 停止前已经把所有记录写完
+            if (n == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+    // 手写的格式化，相当于 "%lld %s, amount %lld\n"。snprintf 每次都要解析
+    // 格式串，单核上它是 Block 策略的主要开销
+    static void format(std::string& out, const LogRecord& r) {
+        char line[128];
+        char* p = appendInt(line, r.timestamp);
+        *p++ = ' ';
+        std::size_t len = strnlen(r.text, sizeof(r.text));
+        std::memcpy(p, r.text, len);
+        p += len;
+        std::memcpy(p, ", amount ", 9);
+        p = appendInt(p + 9, r.amount);
+        *p++ = '\n';
+        out.append(line, p - line);
+    }
+
+    static char* appendInt(char* p, int64_t value) {
+        uint64_t v = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+        if (value < 0) *p++ = '-';
+        char digits[20];
+        int n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v);
+        while (n) *p++ = digits[--n];
+        return p;
+    }
+
+    void writeOut(std::string& buffer) {
+        if (buffer.empty()) return;
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+
+    // 只有本对象还持有、且已经写空的缓冲区说明其线程已退出，可以释放
+    void releaseFinishedRings() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (std::size_t i = 0; i < rings.size();) {
+            if (rings[i].use_count() == 1 && rings[i]->empty()) {
+                rings[i] = rings.back();
+                rings.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    static const std::size_t kBatchBytes = 64 * 1024;
+
+    AsyncLogger(const AsyncLogger&);
+    AsyncLogger& operator=(const AsyncLogger&);
+
+    const Backpressure policy;
+    const std::size_t ringCapacity;
+    std::FILE* file;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> flushRequests;
+    std::atomic<uint64_t> flushesDone;
+    const uint64_t id;
+    std::mutex ringsMutex;
+    std::vector<std::shared_ptr<SpscRing> > rings;
+    std::thread consumer;
+
+    static std::atomic<uint64_t> nextId;
+};
+
+std::atomic<uint64_t> AsyncLogger::nextId(1);
+
+class Transaction {
+public:
+    Transaction(AsyncLogger& logger, const char* logInfo, long amount);
+};
+
+class BuyTransaction : public Transaction {
+public:
+    BuyTransaction(AsyncLogger& logger, long amount)
+        : Transaction(logger, createLogString(), amount) {}
+
+private:
+    static const char* createLogString();
+};
+
+class SellTransaction : public Transaction {
+public:
+    SellTransaction(AsyncLogger& logger, long amount)
+        : Transaction(logger, createLogString(), amount) {}
+
+private:
+    static const char* createLogString();
+};
+
+// 构造函数中只做一次非虚调用，写入环形缓冲区后立即返回
+Transaction::Transaction(AsyncLogger& logger, const char* logInfo,
+                         long amount) {
+    logger.log(logInfo, amount);
+}
+
+const char* BuyTransaction::createLogString() {
+    return "Logged a buy transaction";
+}
+
+const char* SellTransaction::createLogString() {
+    return "Logged a sell transaction";
+}
+
+// 只计调用线程的开销：每轮写入的条数小于缓冲区容量，不会被阻塞
+double callerNs(int rounds, int perRound) {
+    AsyncLogger logger("/tmp/effective-cpp-item09-ex4.log", AsyncLogger::Block);
+    double ns = 0;
+    for (int k = 0; k < rounds; ++k) {
+        logger.flush();
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < perRound; ++i) BuyTransaction b(logger, i);
+        ns += std::chrono::duration<double, std::nano>(Clock::now() - start)
+                  .count();
+    }
+    return ns / (static_cast<double>(rounds) * perRound);
+}
+
+double nsPerTransaction(AsyncLogger::Backpressure policy, int threads,
+                        int perThread, uint64_t& dropped) {
+    AsyncLogger logger("/tmp/effective-cpp-item09-ex4.log", policy);
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&logger, perThread] {
+            for (int i = 0; i < perThread; ++i) {
+                if (i & 1) {
+                    SellTransaction s(logger, i);
+                } else {
+                    BuyTransaction b(logger, i);
+                }
+            }
+        }));
+    }
+    for (std::size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start)
+                    .count() /
+                (static_cast<double>(threads) * perThread);
+    logger.flush();
+    dropped = logger.droppedCount();
+    return ns;
+}
+
+int main() {
+    const int threads = 2;
+    const int perThread = 500000;
+    uint64_t dropped = 0;
+
+    {
+        std::ofstream out("/tmp/effective-cpp-item09-ex4-sync.log");
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < perThread; ++i) {
+            out << "Logged a buy transaction, amount " << i << std::endl;
+        }
+        std::cout << "std::endl on caller thread: "
+                  << std::chrono::duration<double, std::nano>(Clock::now() -
+                                                              start)
+                             .count() /
+                         perThread
+                  << " ns/transaction" << std::endl;
+    }
+
+    std::cout << "async, caller side only:    " << callerNs(100, 10000)
+              << " ns/transaction" << std::endl;
+
+    double block = nsPerTransaction(AsyncLogger::Block, threads, perThread,
+                                    dropped);
+    std::cout << "async, block policy:        " << block
+              << " ns/transaction, dropped " << dropped << std::endl;
+
+    double count = nsPerTransaction(AsyncLogger::Count, threads, perThread,
+                                    dropped);
+    std::cout << "async, count policy:        " << count
+              << " ns/transaction, dropped " << dropped << std::endl;
+
+    {
+        // 同一个线程交替使用两个 logger，每个 logger 只注册一个缓冲区
+        AsyncLogger a("/tmp/effective-cpp-item09-ex4-a.log",
+                      AsyncLogger::Block);
+        AsyncLogger b("/tmp/effective-cpp-item09-ex4-b.log",
+                      AsyncLogger::Block);
+        for (int i = 0; i < 1000; ++i) BuyTransaction t(i & 1 ? a : b, i);
+        std::cout << "rings after alternating loggers: " << a.ringCount()
+                  << " + " << b.ringCount() << std::endl;  // 1 + 1
+    }
+    try {
+        AsyncLogger bad("/tmp/effective-cpp-item09-ex4-bad.log",
+                        AsyncLogger::Block, 1000);
+    } catch (const std::invalid_argument& e) {
+        std::cout << "exception caught: " << e.what() << std::endl;
+    }
+    {
+        AsyncLogger logger("/tmp/effective-cpp-item09-ex4.log",
+                           AsyncLogger::Block);
+        BuyTransaction b(logger, 100);
+        SellTransaction s(logger, 42);
+    }  // logger 析构时保证写完
+    std::ifstream in("/tmp/effective-cpp-item09-ex4.log");
+    std::string line;
+    while (std::getline(in, line)) std::cout << line << std::endl;
+
+    return 0;
+}
\ No newline at end of file
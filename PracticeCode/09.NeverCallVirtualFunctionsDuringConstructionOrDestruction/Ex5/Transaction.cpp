@@ -0,0 +1,447 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 只追加的预写日志（write-ahead log）。
+//
+// 记录格式：[uint32 crc][uint32 长度][uint64 lsn][负载]，crc 覆盖 lsn 和负载。
+// 日志按固定大小的段文件存放，新段创建时预先分配空间，写满后切换到下一段。
+// 开启组提交时，并发的提交者把记录追加到同一个缓冲区，由其中一个线程
+// （leader）一次写出并调用一次 fdatasync，所有人一起返回。
+
+namespace wal {
+
+struct Crc32Table {
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+    uint32_t entries[256];
+};
+
+uint32_t crc32(const void* data, std::size_t size, uint32_t crc = 0) {
+    static const Crc32Table table;  // C++11 保证局部静态变量的初始化线程安全
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+struct Header {
+    uint32_t crc;
+    uint32_t size;
+    uint64_t lsn;
+};
+
+class WriteAheadLog {
+public:
+    struct Options {
+        Options() : segmentSize(4 << 20), groupCommit(true), failAtWrite(0) {}
+        std::size_t segmentSize;
+        bool groupCommit;
+        std::size_t failAtWrite;  // 测试用：第 n 次写盘时模拟失败，0 表示不模拟
+    };
+
+    // 打开日志目录，先回放已有记录，再从新的段文件开始追加
+    WriteAheadLog(const std::string& dir_,
+                  const std::function<void(uint64_t, const std::string&)>&
+                      replay,
+                  const Options& options_ = Options())
+        : dir(dir_),
+          options(options_),
+          fd(-1),
+          segment(0),
+          offset(0),
+          nextLsn(1),
+          durableLsn(0),
+          broken(false),
+          writes(0),
+          flushing(false),
+          syncs(0) {
+        ::mkdir(dir.c_str(), 0755);
+        recover(replay);
+        openSegment(segment + 1);
+    }
+
+    ~WriteAheadLog() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    // 写入一条记录，返回时该记录已持久化。
+    // 负载不能为空：回放时长度为 0 表示预分配的空白，即日志结尾。
+    // 负载也不能超过一个段，否则同一批的其它记录会跟着失败。
+    // 写盘或 fdatasync 失败一次后日志就不可用了，之后的提交都抛出异常：
+    // 失败的记录占用的 lsn 已经无法收回，若继续提交，回放时会在这个缺口处
+    // 停下，之后已确认的记录都会丢失
+    uint64_t commit(const std::string& payload) {
+        if (payload.empty()) {
+            throw std::invalid_argument("wal payload must not be empty");
+        }
+        if (payload.size() > options.segmentSize - sizeof(Header)) {
+            throw std::invalid_argument("wal payload larger than a segment");
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        if (broken) throw std::runtime_error("wal is broken");
+        uint64_t lsn = nextLsn++;
+        Header h;
+        h.size = static_cast<uint32_t>(payload.size());
+        h.lsn = lsn;
+        h.crc = crc32(&h.lsn, sizeof(h.lsn));
+        h.crc = crc32(payload.data(), payload.size(), h.crc);
+        pending.append(reinterpret_cast<const char*>(&h), sizeof(h));
+        pending.append(payload);
+
+        if (!options.groupCommit) {
+            try {
+                writeAndSync(pending);
+            } catch (...) {
+                broken = true;
+                pending.clear();
+                throw;
+            }
+            pending.clear();
+            return lsn;
+        }
+
+        // 已经有 leader 在写盘时，等它写完；若本记录没赶上那一批，
+        // 等待的线程中会有一个成为下一批的 leader
+        while (durableLsn < lsn) {
+            if (broken) throw std::runtime_error("wal commit failed");
+            if (!flushing) {
+                flushing = true;
+                std::string batch;
+                batch.swap(pending);
+                uint64_t last = nextLsn - 1;
+                lock.unlock();
+                try {
+                    writeAndSync(batch);
+                } catch (...) {
+                    lock.lock();
+                    flushing = false;
+                    broken = true;  // 同一批和之后排队的提交者都一起失败
+                    done.notify_all();
+                    throw;
+                }
+                lock.lock();
+                flushing = false;
+                durableLsn = last;
+                done.notify_all();
+            } else {
+                done.wait(lock);
+            }
+        }
+        return lsn;
+    }
+
+    uint64_t syncCount() const { return syncs; }
+
+private:
+    std::string segmentPath(uint32_t n) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/wal-%08u.log", n);
+        return dir + name;
+    }
+
+    void openSegment(uint32_t n) {
+        if (fd >= 0) ::close(fd);
+        fd = ::open(segmentPath(n).c_str(), O_CREAT | O_WRONLY | O_TRUNC,
+                    0644);
+        if (fd < 0) throw std::runtime_error("cannot open wal segment");
+        // 预先分配整个段，之后的 fdatasync 无需再更新文件大小等元数据
+        if (::posix_fallocate(fd, 0, options.segmentSize) != 0) {
+            throw std::runtime_error("cannot preallocate wal segment");
+        }
+        if (::fsync(fd) != 0) throw std::runtime_error("fsync failed");
+        // 新文件的目录项也要持久化，否则崩溃后整个段可能连同记录一起消失
+        int d = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (d < 0) throw std::runtime_error("cannot open wal directory");
+        int rc = ::fsync(d);
+        ::close(d);
+        if (rc != 0) throw std::runtime_error("wal directory fsync failed");
+        segment = n;
+        offset = 0;
+    }
+
+    // 只由持有写权限的线程调用（非组提交时持有 mutex，组提交时为 leader）
+    void writeAndSync(const std::string& batch) {
+        if (++writes == options.failAtWrite) {
+            throw std::runtime_error("injected wal write failure");
+        }
+        std::size_t pos = 0;
+        while (pos < batch.size()) {
+            // 一批记录可能跨段，按记录边界切分
+            std::size_t end = pos;
+            while (end < batch.size()) {
+                Header h;
+                std::memcpy(&h, batch.data() + end, sizeof(h));
+                std::size_t len = sizeof(h) + h.size;
+                if (offset + (end - pos) + len > options.segmentSize) break;
+                end += len;
+            }
+            if (end == pos) {
+                if (offset == 0) throw std::runtime_error("record too large");
+                if (::fdatasync(fd) != 0) {
+                    throw std::runtime_error("fdatasync failed");
+                }
+                openSegment(segment + 1);
+                continue;
+            }
+            ssize_t n = ::pwrite(fd, batch.data() + pos, end - pos, offset);
+            if (n != static_cast<ssize_t>(end - pos)) {
+                throw std::runtime_error("wal write failed");
+            }
+            offset += end - pos;
+            pos = end;
+        }
+        if (::fdatasync(fd) != 0) throw std::runtime_error("fdatasync failed");
+        ++syncs;
+    }
+
+    // 按段号顺序回放，遇到长度为 0（预分配的空白）或 crc 不匹配即停止：
+    // 崩溃时写了一半的记录会在这里被丢弃
+    void recover(
+        const std::function<void(uint64_t, const std::string&)>& replay) {
+        std::vector<uint32_t> segments;
+        if (DIR* d = ::opendir(dir.c_str())) {
+            while (dirent* e = ::readdir(d)) {
+                unsigned n;
+                if (std::sscanf(e->d_name, "wal-%08u.log", &n) == 1) {
+                    segments.push_back(n);
+                }
+            }
+            ::closedir(d);
+        }
+        std::sort(segments.begin(), segments.end());
+
+        std::string payload;
+        for (std::size_t s = 0; s < segments.size(); ++s) {
+            segment = segments[s];
+            int in = ::open(segmentPath(segment).c_str(), O_RDONLY);
+            if (in < 0) continue;
+            off_t pos = 0;
+            Header h;
+            while (::pread(in, &h, sizeof(h), pos) ==
+                       static_cast<ssize_t>(sizeof(h)) &&
+                   h.size != 0 && h.size <= options.segmentSize) {
+                payload.resize(h.size);
+                if (::pread(in, &payload[0], h.size, pos + sizeof(h)) !=
+                    static_cast<ssize_t>(h.size)) {
+                    break;
+                }
+                uint32_t crc = crc32(&h.lsn, sizeof(h.lsn));
+                crc = crc32(payload.data(), payload.size(), crc);
+                if (crc != h.crc || h.lsn != nextLsn) break;
+                replay(h.lsn, payload);
+                nextLsn = h.lsn + 1;
+                pos += sizeof(h) + h.size;
+            }
+            ::close(in);
+        }
+        durableLsn = nextLsn - 1;
+    }
+
+    WriteAheadLog(const WriteAheadLog&);
+    WriteAheadLog& operator=(const WriteAheadLog&);
+
+    std::string dir;
+    Options options;
+    int fd;
+    uint32_t segment;
+    std::size_t offset;
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::string pending;  // 等待写盘的记录
+    uint64_t nextLsn;
+    uint64_t durableLsn;
+    bool broken;  // 写盘失败过，拒绝之后的所有提交
+    uint64_t writes;
+    bool flushing;
+    uint64_t syncs;
+};
+
+}  // namespace wal
+
+class Transaction {
+public:
+    // 构造完成时交易记录已写入日志并持久化
+    Transaction(wal::WriteAheadLog& log, const std::string& logInfo);
+};
+
+class BuyTransaction : public Transaction {
+public:
+    BuyTransaction(wal::WriteAheadLog& log, long amount)
+        : Transaction(log, createLogString(amount)) {}
+
+private:
+    static std::string createLogString(long amount);
+};
+
+class SellTransaction : public Transaction {
+public:
+    SellTransaction(wal::WriteAheadLog& log, long amount)
+        : Transaction(log, createLogString(amount)) {}
+
+private:
+    static std::string createLogString(long amount);
+};
+
+Transaction::Transaction(wal::WriteAheadLog& log, const std::string& logInfo) {
+    log.commit(logInfo);
+}
+
+std::string BuyTransaction::createLogString(long amount) {
+    return "buy " + std::to_string(amount);
+}
+
+std::string SellTransaction::createLogString(long amount) {
+    return "sell " + std::to_string(amount);
+}
+
+void removeDir(const std::string& dir) {
+    if (DIR* d = ::opendir(dir.c_str())) {
+        while (dirent* e = ::readdir(d)) {
+            if (e->d_name[0] != '.') ::unlink((dir + "/" + e->d_name).c_str());
+        }
+        ::closedir(d);
+    }
+    ::rmdir(dir.c_str());
+}
+
+void noReplay(uint64_t, const std::string&) {}
+
+int main() {
+    const std::string dir = "/tmp/effective-cpp-item09-ex5-wal";
+    typedef std::chrono::steady_clock Clock;
+
+    // 1. 写入一些交易，再模拟崩溃时写了一半的记录，然后回放
+    removeDir(dir);
+    {
+        wal::WriteAheadLog log(dir, noReplay);
+        for (int i = 0; i < 5; ++i) {
+            BuyTransaction b(log, 100 + i);
+            SellTransaction s(log, 200 + i);
+        }
+        try {
+            log.commit("");
+        } catch (const std::invalid_argument& e) {
+            std::cout << "exception caught: " << e.what() << std::endl;
+        }
+    }
+    {
+        int fd = ::open((dir + "/wal-00000001.log").c_str(), O_WRONLY);
+        wal::Header torn = {0xDEADBEEF, 64, 11};
+        off_t end = 0;
+        {
+            // 找到第一段中最后一条有效记录之后的位置
+            int in = ::open((dir + "/wal-00000001.log").c_str(), O_RDONLY);
+            wal::Header h;
+            while (::pread(in, &h, sizeof(h), end) == sizeof(h) && h.size) {
+                end += sizeof(h) + h.size;
+            }
+            ::close(in);
+        }
+        ::pwrite(fd, &torn, sizeof(torn), end);
+        ::pwrite(fd, "half", 4, end + sizeof(torn));
+        ::close(fd);
+    }
+    {
+        int replayed = 0;
+        wal::WriteAheadLog log(dir, [&replayed](uint64_t lsn,
+                                                const std::string& rec) {
+            if (replayed++ < 3) std::cout << "replay " << lsn << ": " << rec
+                                          << std::endl;
+        });
+        std::cout << "recovered " << replayed
+                  << " records, torn record discarded" << std::endl;
+    }
+
+    // 2. 第三次写盘失败后日志不再接受提交，回放得到全部已确认的记录
+    removeDir(dir);
+    {
+        wal::WriteAheadLog::Options options;
+        options.segmentSize = 4096;
+        options.failAtWrite = 3;
+        wal::WriteAheadLog log(dir, noReplay, options);
+        try {
+            log.commit(std::string(options.segmentSize, 'x'));
+        } catch (const std::invalid_argument& e) {
+            std::cout << "exception caught: " << e.what() << std::endl;
+        }
+        log.commit("acked 1");
+        log.commit("acked 2");
+        for (int i = 0; i < 2; ++i) {
+            try {
+                log.commit("rejected");
+            } catch (const std::runtime_error& e) {
+                std::cout << "exception caught: " << e.what() << std::endl;
+            }
+        }
+    }
+    {
+        int replayed = 0;
+        wal::WriteAheadLog log(dir, [&replayed](uint64_t,
+                                                const std::string& rec) {
+            if (rec.compare(0, 5, "acked") == 0) ++replayed;
+        });
+        std::cout << "recovered " << replayed << " of 2 acknowledged records"
+                  << std::endl;
+    }
+
+    // 3. 1 到 64 个提交线程，比较是否开启组提交
+    for (int group = 0; group < 2; ++group) {
+        for (int threads = 1; threads <= 64; threads *= 4) {
+            removeDir(dir);
+            wal::WriteAheadLog::Options options;
+            options.groupCommit = group;
+            options.segmentSize = 1 << 20;
+            wal::WriteAheadLog log(dir, noReplay, options);
+            const int total = 2048;
+            Clock::time_point start = Clock::now();
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; ++t) {
+                workers.push_back(std::thread([&log, threads, t] {
+                    for (int i = 0; i < total / threads; ++i) {
+                        if (i & 1) {
+                            SellTransaction s(log, i);
+                        } else {
+                            BuyTransaction b(log, t);
+                        }
+                    }
+                }));
+            }
+            for (std::size_t t = 0; t < workers.size(); ++t) workers[t].join();
+            double seconds =
+                std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout << (group ? "group commit, " : "no group commit, ")
+                      << threads << " threads: " << total / seconds
+                      << " commits/s, " << log.syncCount() << " fdatasync"
+                      << std::endl;
+        }
+    }
+    removeDir(dir);
+
+    return 0;
+}
\ No newline at end of file
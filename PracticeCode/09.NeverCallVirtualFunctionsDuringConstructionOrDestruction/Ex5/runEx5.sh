@@ -0,0 +1,2 @@
+g++ Transaction.cpp -o Transaction.out -std=c++11 -O2 -pthread
+./Transaction.out
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "LogFormats.hpp"
+
+// 离线解码工具：把 BinaryLog 写出的二进制日志还原成文本
+// 用法：./Decoder.out <binary log>
+
+std::string render(const char* format, const int64_t* args) {
+    std::string out;
+    for (const char* p = format; *p; ++p) {
+        if (*p != '%') {
+            out += *p;
+        } else if (p[1] == '%') {
+            out += '%';
+            ++p;
+        } else {
+            out += std::to_string(static_cast<long long>(*args++));
+            // LogFormats.hpp 保证占位符都是 "%lld"，跳过其中的 "lld"
+            p += std::strlen("lld");
+        }
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <binary log>" << std::endl;
+        return 1;
+    }
+    std::FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    logfmt::FileHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, logfmt::kMagic, sizeof(header.magic)) != 0) {
+        std::cerr << "not a binary log" << std::endl;
+        return 1;
+    }
+    // 写入时的格式表必须是当前表的前缀
+    if (header.formatCount > logfmt::kFormatCount ||
+        header.tableHash != logfmt::tableHash(
+                                static_cast<uint16_t>(header.formatCount))) {
+        std::cerr << "log was written with a different format table"
+                  << std::endl;
+        return 1;
+    }
+
+    uint16_t id;
+    int64_t args[8];
+    while (std::fread(&id, sizeof(id), 1, file) == 1) {
+        if (id >= header.formatCount) {
+            std::cerr << "corrupted record: unknown format " << id << std::endl;
+            return 1;
+        }
+        const char* format = logfmt::kFormats[id];
+        std::size_t count = logfmt::argCount(format);
+        if (std::fread(args, sizeof(int64_t), count, file) != count) {
+            std::cerr << "truncated record" << std::endl;
+            return 1;
+        }
+        std::cout << render(format, args) << '\n';
+    }
+    std::fclose(file);
+    return 0;
+}
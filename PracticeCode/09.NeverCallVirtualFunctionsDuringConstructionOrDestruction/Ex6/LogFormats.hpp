@@ -0,0 +1,167 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+// 编译期注册的日志格式表。热路径上只记录格式编号和原始参数，
+// 不分配内存也不做格式化，由离线的 Decoder 把二进制日志还原成文本。
+// 目前参数只支持整数，格式串中统一使用 %lld，由下面的 static_assert 检查。
+
+namespace logfmt {
+
+// 新增格式只能追加在末尾，否则旧日志文件的编号会对不上。
+// 文件头记录写入时的格式个数和这些格式的指纹，只要旧表是新表的前缀，
+// 新的 Decoder 仍能解码旧日志
+constexpr const char* kFormats[] = {
+    "Logged a buy transaction, amount %lld",
+    "Logged a sell transaction, amount %lld",
+    "Finished %lld transactions in %lld ns",
+    "Transaction log started",
+};
+
+constexpr uint16_t kFormatCount = sizeof(kFormats) / sizeof(kFormats[0]);
+
+constexpr bool equal(const char* a, const char* b) {
+    while (*a && *a == *b) ++a, ++b;
+    return *a == *b;
+}
+
+constexpr uint16_t idOf(const char* format) {
+    for (uint16_t i = 0; i < kFormatCount; ++i) {
+        if (equal(kFormats[i], format)) return i;
+    }
+    // 在常量求值中抛出异常会导致编译错误：格式串没有在表中注册
+    throw std::logic_error("log format is not registered");
+}
+
+// 格式串中参数的个数（"%%" 不算）
+constexpr std::size_t argCount(const char* format) {
+    std::size_t n = 0;
+    for (; *format; ++format) {
+        if (*format != '%') continue;
+        if (format[1] == '%') {
+            ++format;
+        } else {
+            ++n;
+        }
+    }
+    return n;
+}
+
+// 除 "%%" 外每个占位符都必须是 %lld：记录中每个参数都是 8 字节整数，
+// Decoder 也按 %lld 解析
+constexpr bool onlyLld(const char* format) {
+    for (; *format; ++format) {
+        if (*format != '%') continue;
+        if (format[1] == '%') {
+            ++format;
+        } else if (format[1] != 'l' || format[2] != 'l' || format[3] != 'd') {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool allFormatsOnlyLld() {
+    for (uint16_t i = 0; i < kFormatCount; ++i) {
+        if (!onlyLld(kFormats[i])) return false;
+    }
+    return true;
+}
+
+static_assert(allFormatsOnlyLld(), "log formats may only use %lld");
+
+// 表中前 count 个格式的指纹，写在日志文件头中，解码时用来确认格式表一致
+constexpr uint64_t tableHash(uint16_t count = kFormatCount) {
+    uint64_t h = 14695981039346656037ULL;
+    for (uint16_t i = 0; i < count; ++i) {
+        for (const char* p = kFormats[i]; *p; ++p) {
+            h = (h ^ static_cast<unsigned char>(*p)) * 1099511628211ULL;
+        }
+        h = (h ^ 0xFF) * 1099511628211ULL;
+    }
+    return h;
+}
+
+constexpr char kMagic[8] = {'E', 'F', 'F', 'L', 'O', 'G', '2', '\0'};
+
+struct FileHeader {
+    char magic[8];
+    uint64_t tableHash;    // 前 formatCount 个格式的指纹
+    uint64_t formatCount;  // 写入时格式表的大小
+};
+
+// 二进制日志写入器。一条记录为 [uint16 格式编号][每个参数 8 字节]，
+// 先写入固定大小的缓冲区，满了才写文件
+class BinaryLog {
+public:
+    explicit BinaryLog(const char* path)
+        : file(std::fopen(path, "wb")), used(0) {
+        if (!file) throw std::runtime_error("BinaryLog: cannot open file");
+        FileHeader header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.tableHash = tableHash();
+        header.formatCount = kFormatCount;
+        std::fwrite(&header, sizeof(header), 1, file);
+    }
+
+    ~BinaryLog() {
+        flush();
+        std::fclose(file);
+    }
+
+    template <typename... Args>
+    void write(uint16_t id, Args... args) {
+        static_assert(sizeof...(Args) <= 8, "too many log arguments");
+        const std::size_t size = sizeof(id) + sizeof...(Args) * 8;
+        if (used + size > sizeof(buffer)) flush();
+        std::memcpy(buffer + used, &id, sizeof(id));
+        used += sizeof(id);
+        int expand[] = {0, (append(args), 0)...};
+        (void)expand;
+    }
+
+    void flush() {
+        std::fwrite(buffer, 1, used, file);
+        used = 0;
+    }
+
+private:
+    template <typename T>
+    void append(T value) {
+        static_assert(std::is_integral<T>::value,
+                      "only integral log arguments are supported");
+        int64_t raw = static_cast<int64_t>(value);
+        std::memcpy(buffer + used, &raw, sizeof(raw));
+        used += sizeof(raw);
+    }
+
+    BinaryLog(const BinaryLog&);
+    BinaryLog& operator=(const BinaryLog&);
+
+    std::FILE* file;
+    std::size_t used;
+    char buffer[64 * 1024];
+};
+
+// BINARY_LOG 的实现：在编译期检查参数个数
+template <uint16_t Id, typename... Args>
+void writeFormat(BinaryLog& log, const char*, Args... args) {
+    static_assert(argCount(kFormats[Id]) == sizeof...(Args),
+                  "argument count does not match the log format");
+    log.write(Id, args...);
+}
+
+}  // namespace logfmt
+
+// 在编译期把格式串换成编号，并检查参数个数
+#define LOG_FORMAT_ID(format)                                   \
+    std::integral_constant<uint16_t, logfmt::idOf(format)>::value
+
+// 用法：BINARY_LOG(log, format, 参数...)，参数可以没有。
+// 格式串放在 __VA_ARGS__ 中，这样没有参数时也不会留下多余的逗号
+#define BINARY_LOG_FORMAT(format, ...) format
+#define BINARY_LOG(log, ...)                                                \
+    logfmt::writeFormat<LOG_FORMAT_ID(BINARY_LOG_FORMAT(__VA_ARGS__, 0))>( \
+        (log), __VA_ARGS__)
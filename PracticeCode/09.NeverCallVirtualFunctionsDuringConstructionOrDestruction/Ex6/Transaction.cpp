@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "LogFormats.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+class Transaction {
+public:
+    // 只接收格式编号和参数，构造时不再拼接字符串
+    Transaction(logfmt::BinaryLog& log, uint16_t formatId, long amount);
+};
+
+class BuyTransaction : public Transaction {
+public:
+    BuyTransaction(logfmt::BinaryLog& log, long amount)
+        : Transaction(log, createLogFormat(), amount) {}
+
+    static constexpr uint16_t createLogFormat() {
+        return LOG_FORMAT_ID("Logged a buy transaction, amount %lld");
+    }
+};
+
+class SellTransaction : public Transaction {
+public:
+    SellTransaction(logfmt::BinaryLog& log, long amount)
+        : Transaction(log, createLogFormat(), amount) {}
+
+    static constexpr uint16_t createLogFormat() {
+        return LOG_FORMAT_ID("Logged a sell transaction, amount %lld");
+    }
+};
+
+// Transaction 只传一个参数，编译期确认两种格式都恰好需要一个参数
+static_assert(logfmt::argCount(
+                  logfmt::kFormats[BuyTransaction::createLogFormat()]) == 1,
+              "buy format must take exactly one argument");
+static_assert(logfmt::argCount(
+                  logfmt::kFormats[SellTransaction::createLogFormat()]) == 1,
+              "sell format must take exactly one argument");
+
+Transaction::Transaction(logfmt::BinaryLog& log, uint16_t formatId,
+                         long amount) {
+    log.write(formatId, amount);
+}
+
+// 原来的做法：每次构造都拼接字符串并格式化输出
+class TextTransaction {
+public:
+    TextTransaction(std::FILE* file, const std::string& logInfo, long amount) {
+        std::fprintf(file, "%s, amount %ld\n", logInfo.c_str(), amount);
+    }
+};
+
+std::string createLogString(bool buy) {
+    return buy ? "Logged a buy transaction" : "Logged a sell transaction";
+}
+
+long fileSize(const char* path) {
+    std::FILE* f = std::fopen(path, "rb");
+    std::fseek(f, 0, SEEK_END);
+    long size = std::ftell(f);
+    std::fclose(f);
+    return size;
+}
+
+int main() {
+    const long n = 2000000;
+    const char* textPath = "/tmp/effective-cpp-item09-ex6.txt";
+    const char* binaryPath = "/tmp/effective-cpp-item09-ex6.bin";
+
+    Clock::time_point start = Clock::now();
+    {
+        std::FILE* file = std::fopen(textPath, "w");
+        for (long i = 0; i < n; ++i) {
+            TextTransaction t(file, createLogString(i % 2 == 0), i);
+        }
+        std::fclose(file);
+    }
+    double textNs =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    start = Clock::now();
+    {
+        logfmt::BinaryLog log(binaryPath);
+        BINARY_LOG(log, "Transaction log started");
+        for (long i = 0; i < n; ++i) {
+            if (i % 2 == 0) {
+                BuyTransaction b(log, i);
+            } else {
+                SellTransaction s(log, i);
+            }
+        }
+        long elapsed = static_cast<long>(
+            std::chrono::duration<double, std::nano>(Clock::now() - start)
+                .count());
+        BINARY_LOG(log, "Finished %lld transactions in %lld ns", n, elapsed);
+    }
+    double binaryNs =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    std::cout << "text log:   " << textNs / n << " ns/transaction, "
+              << fileSize(textPath) << " bytes" << std::endl;
+    std::cout << "binary log: " << binaryNs / n << " ns/transaction, "
+              << fileSize(binaryPath) << " bytes" << std::endl;
+
+    return 0;
+}
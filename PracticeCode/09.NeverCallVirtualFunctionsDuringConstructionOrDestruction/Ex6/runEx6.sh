@@ -0,0 +1,4 @@
+g++ Transaction.cpp -o Transaction.out -std=c++17 -O2
+g++ Decoder.cpp -o Decoder.out -std=c++17 -O2
+./Transaction.out
+./Decoder.out /tmp/effective-cpp-item09-ex6.bin | tail -n 3
\ No newline at end of file
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// 价格-时间优先的限价订单簿。
+//
+// - 价格以最小变动单位（tick）表示，在 [0, levels) 范围内用平坦数组存放每个
+//   价位，同一价位的订单用侵入式双向链表按到达顺序排队
+// - 订单节点在构造时一次性分配好，用空闲链表复用；撮合路径上没有内存分配
+// - 用位图记录哪些价位非空，最优价位被吃空后按 64 位一组查找下一个价位
+
+enum Side { Buy, Sell };
+
+struct Order {
+    uint64_t id;
+    uint32_t price;
+    uint32_t quantity;
+    Side side;
+    Order* prev;
+    Order* next;  // 同一价位的下一个订单；空闲时用作空闲链表
+};
+
+struct PriceLevel {
+    Order* head;
+    Order* tail;
+    uint64_t quantity;
+};
+
+// 非空价位的位图
+class LevelBitmap {
+public:
+    explicit LevelBitmap(std::size_t levels) : words((levels + 63) / 64, 0) {}
+
+    void set(std::size_t i) { words[i / 64] |= 1ULL << (i % 64); }
+    void clear(std::size_t i) { words[i / 64] &= ~(1ULL << (i % 64)); }
+
+    // 大于等于 i 的第一个非空价位，不存在时返回 npos
+    std::size_t nextAtOrAbove(std::size_t i) const {
+        std::size_t w = i / 64;
+        if (w >= words.size()) return npos;
+        uint64_t bits = words[w] & (~0ULL << (i % 64));
+        while (!bits) {
+            if (++w == words.size()) return npos;
+            bits = words[w];
+        }
+        return w * 64 + __builtin_ctzll(bits);
+    }
+
+    // 小于等于 i 的第一个非空价位，不存在时返回 npos
+    std::size_t nextAtOrBelow(std::size_t i) const {
+        std::size_t w = i / 64;
+        uint64_t bits = words[w] & (~0ULL >> (63 - i % 64));
+        while (!bits) {
+            if (w-- == 0) return npos;
+            bits = words[w];
+        }
+        return w * 64 + 63 - __builtin_clzll(bits);
+    }
+
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+private:
+    std::vector<uint64_t> words;
+};
+
+class OrderBook {
+public:
+    // levels：价格范围；maxOrders：同时挂单数量上限；maxId：订单编号上限
+    OrderBook(std::size_t levels_, std::size_t maxOrders, std::size_t maxId)
+        : levels(levels_),
+          bids(levels_),
+          asks(levels_),
+          bidLevels(levels_),
+          askLevels(levels_),
+          bestBid(LevelBitmap::npos),
+          bestAsk(LevelBitmap::npos),
+          pool(maxOrders),
+          freeList(0),
+          byId(maxId, 0),
+          fills(0),
+          filledQuantity(0) {
+        for (std::size_t i = 0; i < levels; ++i) {
+            bids[i].head = bids[i].tail = asks[i].head = asks[i].tail = 0;
+            bids[i].quantity = asks[i].quantity = 0;
+        }
+        for (std::size_t i = 0; i < pool.size(); ++i) {
+            pool[i].next = freeList;
+            freeList = &pool[i];
+        }
+    }
+
+    // 提交一个限价单：先与对手方撮合，剩余部分挂在订单簿上
+    void add(uint64_t id, Side side, uint32_t price, uint32_t quantity) {
+        if (price >= levels || id >= byId.size() || byId[id]) {
+            throw std::invalid_argument("bad order");
+        }
+        // 在撮合之前检查，保证抛出异常时订单簿没有被修改
+        if (!freeList) throw std::length_error("order pool exhausted");
+        quantity = side == Buy ? matchBuy(price, quantity)
+                               : matchSell(price, quantity);
+        if (quantity == 0) return;
+
+        Order* o = freeList;
+        freeList = o->next;
+        o->id = id;
+        o->price = price;
+        o->quantity = quantity;
+        o->side = side;
+        byId[id] = o;
+
+        PriceLevel& level = side == Buy ? bids[price] : asks[price];
+        o->prev = level.tail;
+        o->next = 0;
+        if (level.tail) {
+            level.tail->next = o;
+        } else {
+            level.head = o;
+            (side == Buy ? bidLevels : askLevels).set(price);
+        }
+        level.tail = o;
+        level.quantity += quantity;
+        if (side == Buy && (bestBid == LevelBitmap::npos || price > bestBid)) {
+            bestBid = price;
+        }
+        if (side == Sell && (bestAsk == LevelBitmap::npos || price < bestAsk)) {
+            bestAsk = price;
+        }
+    }
+
+    // 撤单，O(1)
+    bool cancel(uint64_t id) {
+        if (id >= byId.size() || !byId[id]) return false;
+        Order* o = byId[id];
+        PriceLevel& level = o->side == Buy ? bids[o->price] : asks[o->price];
+        level.quantity -= o->quantity;
+        unlink(level, o);
+        if (!level.head) levelEmptied(o->side, o->price);
+        release(o);
+        return true;
+    }
+
+    std::size_t bestBidPrice() const { return bestBid; }
+    std::size_t bestAskPrice() const { return bestAsk; }
+    uint64_t fillCount() const { return fills; }
+    uint64_t filledVolume() const { return filledQuantity; }
+
+private:
+    uint32_t matchBuy(uint32_t price, uint32_t quantity) {
+        while (quantity && bestAsk != LevelBitmap::npos && bestAsk <= price) {
+            quantity = fillLevel(asks[bestAsk], quantity);
+            if (!asks[bestAsk].head) levelEmptied(Sell, bestAsk);
+        }
+        return quantity;
+    }
+
+    uint32_t matchSell(uint32_t price, uint32_t quantity) {
+        while (quantity && bestBid != LevelBitmap::npos && bestBid >= price) {
+            quantity = fillLevel(bids[bestBid], quantity);
+            if (!bids[bestBid].head) levelEmptied(Buy, bestBid);
+        }
+        return quantity;
+    }
+
+    // 按时间顺序吃掉一个价位上的订单，返回剩余数量
+    uint32_t fillLevel(PriceLevel& level, uint32_t quantity) {
+        while (quantity && level.head) {
+            Order* o = level.head;
+            uint32_t traded = std::min(quantity, o->quantity);
+            quantity -= traded;
+            o->quantity -= traded;
+            level.quantity -= traded;
+            ++fills;
+            filledQuantity += traded;
+            if (o->quantity == 0) {
+                unlink(level, o);
+                release(o);
+            }
+        }
+        return quantity;
+    }
+
+    void unlink(PriceLevel& level, Order* o) {
+        (o->prev ? o->prev->next : level.head) = o->next;
+        (o->next ? o->next->prev : level.tail) = o->prev;
+    }
+
+    void release(Order* o) {
+        byId[o->id] = 0;
+        o->next = freeList;
+        freeList = o;
+    }
+
+    void levelEmptied(Side side, uint32_t price) {
+        if (side == Buy) {
+            bidLevels.clear(price);
+            if (price == bestBid) {
+                bestBid = price ? bidLevels.nextAtOrBelow(price - 1)
+                                : LevelBitmap::npos;
+            }
+        } else {
+            askLevels.clear(price);
+            if (price == bestAsk) bestAsk = askLevels.nextAtOrAbove(price + 1);
+        }
+    }
+
+    OrderBook(const OrderBook&);
+    OrderBook& operator=(const OrderBook&);
+
+    const std::size_t levels;
+    std::vector<PriceLevel> bids;
+    std::vector<PriceLevel> asks;
+    LevelBitmap bidLevels;
+    LevelBitmap askLevels;
+    std::size_t bestBid;
+    std::size_t bestAsk;
+    std::vector<Order> pool;
+    Order* freeList;
+    std::vector<Order*> byId;
+    uint64_t fills;
+    uint64_t filledQuantity;
+};
+
+// 交易在构造时提交给订单簿。与 Ex3 相同，派生类把所需的信息传给基类构造函数，
+// 而不是让基类在构造期间调用虚函数
+class Transaction {
+public:
+    Transaction(OrderBook& book, uint64_t id, Side side, uint32_t price,
+                uint32_t quantity) {
+        book.add(id, side, price, quantity);
+    }
+};
+
+class BuyTransaction : public Transaction {
+public:
+    BuyTransaction(OrderBook& book, uint64_t id, uint32_t price,
+                   uint32_t quantity)
+        : Transaction(book, id, Buy, price, quantity) {}
+};
+
+class SellTransaction : public Transaction {
+public:
+    SellTransaction(OrderBook& book, uint64_t id, uint32_t price,
+                    uint32_t quantity)
+        : Transaction(book, id, Sell, price, quantity) {}
+};
+
+// 预先生成的确定性事件序列，回放时不涉及随机数和内存分配
+struct Event {
+    enum Type { AddBuy, AddSell, Cancel } type;
+    uint64_t id;
+    uint32_t price;
+    uint32_t quantity;
+};
+
+std::vector<Event> generate(std::size_t n, uint32_t mid) {
+    std::vector<Event> events;
+    events.reserve(n);
+    uint64_t rng = 0x2545F4914F6CDD1DULL;
+    uint64_t nextId = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        Event e;
+        uint32_t r = rng % 100;
+        if (r < 30 && nextId > 0) {
+            e.type = Event::Cancel;
+            e.id = nextId - 1 - (rng >> 32) % std::min<uint64_t>(nextId, 1000);
+        } else {
+            e.type = r % 2 ? Event::AddBuy : Event::AddSell;
+            e.id = nextId++;
+            // 大多数订单落在中间价附近，少数会越过中间价直接成交
+            int offset = static_cast<int>((rng >> 20) % 40) - 20;
+            e.price = e.type == Event::AddBuy ? mid - 10 + offset
+                                              : mid + 10 + offset;
+            e.quantity = 1 + (rng >> 40) % 100;
+        }
+        events.push_back(e);
+    }
+    return events;
+}
+
+int main() {
+    typedef std::chrono::steady_clock Clock;
+    const std::size_t n = 2000000;
+    const uint32_t levels = 4096;
+    std::vector<Event> events = generate(n, levels / 2);
+    std::vector<uint32_t> latency(n);
+
+    OrderBook book(levels, n, n);
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) {
+        const Event& e = events[i];
+        Clock::time_point t0 = Clock::now();
+        if (e.type == Event::AddBuy) {
+            BuyTransaction b(book, e.id, e.price, e.quantity);
+        } else if (e.type == Event::AddSell) {
+            SellTransaction s(book, e.id, e.price, e.quantity);
+        } else {
+            book.cancel(e.id);
+        }
+        latency[i] = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                 t0)
+                .count());
+    }
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(latency.begin(), latency.end());
+    std::cout << "replayed " << n << " events: " << n / seconds / 1e6
+              << " M orders/s (including timing overhead)" << std::endl;
+    std::cout << "latency p50 " << latency[n / 2] << " ns, p99 "
+              << latency[n * 99 / 100] << " ns, p999 "
+              << latency[n * 999 / 1000] << " ns" << std::endl;
+    std::cout << "fills: " << book.fillCount()
+              << ", volume: " << book.filledVolume()
+              << ", best bid/ask: " << book.bestBidPrice() << "/"
+              << book.bestAskPrice() << std::endl;
+
+    return 0;
+}
\ No newline at end of file
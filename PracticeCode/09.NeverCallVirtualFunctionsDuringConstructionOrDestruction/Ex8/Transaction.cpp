@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Transaction 的压力测试工具。
+//
+// 开环模式（open）：按固定到达率发出交易，延迟从“计划开始时间”算起。这样当
+// 系统变慢时，排在后面的请求等待的时间也会计入延迟，避免协调遗漏（coordinated
+// omission）低估尾延迟。
+// 闭环模式（closed）：每个线程完成一笔交易后立即发出下一笔，测量服务时间。
+//
+// 用法：./Transaction.out [--mode open|closed] [--threads N] [--rate 每秒总笔数]
+//                         [--seconds 秒数] [--buy-percent 0-100]
+
+// ---------------------------------------------------------------------------
+// 被测对象：与 Ex3 相同的 Transaction 层次结构，日志写到可配置的输出流
+
+std::ostream* transactionLog = &std::cout;
+std::mutex transactionLogMutex;
+
+class Transaction {
+public:
+    explicit Transaction(const std::string& logInfo);
+    void logTransaction(const std::string& logInfo) const;
+};
+
+class BuyTransaction : public Transaction {
+public:
+    BuyTransaction() : Transaction(createLogString()) {}
+
+private:
+    static std::string createLogString();
+};
+
+class SellTransaction : public Transaction {
+public:
+    SellTransaction() : Transaction(createLogString()) {}
+
+private:
+    static std::string createLogString();
+};
+
+Transaction::Transaction(const std::string& logInfo) {
+    logTransaction(logInfo);
+}
+
+void Transaction::logTransaction(const std::string& logInfo) const {
+    std::lock_guard<std::mutex> lock(transactionLogMutex);
+    *transactionLog << logInfo << std::endl;
+}
+
+std::string BuyTransaction::createLogString() {
+    return "Logged a buy transaction";
+}
+
+std::string SellTransaction::createLogString() {
+    return "Logged a sell transaction";
+}
+
+// ---------------------------------------------------------------------------
+// HDR 风格的直方图：按 2 的幂分段，每段再线性分成 2^kSubBits 个桶，
+// 相对误差不超过 1/2^kSubBits，占用内存固定，可以直接相加合并
+
+class Histogram {
+public:
+    Histogram() : counts(kBuckets, 0), total(0), sum(0), maxValue(0) {}
+
+    void record(uint64_t value) {
+        ++counts[bucketOf(value)];
+        ++total;
+        sum += value;
+        maxValue = std::max(maxValue, value);
+    }
+
+    void merge(const Histogram& rhs) {
+        for (std::size_t i = 0; i < kBuckets; ++i) counts[i] += rhs.counts[i];
+        total += rhs.total;
+        sum += rhs.sum;
+        maxValue = std::max(maxValue, rhs.maxValue);
+    }
+
+    // 返回不小于该分位数的桶的上界
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * total));
+        rank = std::max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(upperBound(i), maxValue);
+        }
+        return maxValue;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0; }
+
+private:
+    static const int kSubBits = 5;
+    static const uint64_t kSub = 1 << kSubBits;
+    static const std::size_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+    static std::size_t bucketOf(uint64_t v) {
+        if (v < kSub) return v;
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - kSubBits;
+        return (shift + 1) * kSub + ((v >> shift) - kSub);
+    }
+
+    static uint64_t upperBound(std::size_t bucket) {
+        if (bucket < kSub) return bucket;
+        int shift = static_cast<int>(bucket / kSub) - 1;
+        uint64_t base = (kSub + bucket % kSub) << shift;
+        return base + (1ULL << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t sum;
+    uint64_t maxValue;
+};
+
+// ---------------------------------------------------------------------------
+
+struct Config {
+    Config()
+        : open(false), threads(4), rate(100000), seconds(2), buyPercent(50) {}
+    bool open;
+    int threads;
+    double rate;  // 开环模式下所有线程合计的每秒交易数
+    double seconds;
+    int buyPercent;
+};
+
+Config parse(int argc, char** argv) {
+    Config c;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        const char* value = argv[i + 1];
+        if (key == "--mode") {
+            c.open = std::strcmp(value, "open") == 0;
+        } else if (key == "--threads") {
+            c.threads = std::max(1, std::atoi(value));
+        } else if (key == "--rate") {
+            c.rate = std::max(1.0, std::atof(value));
+        } else if (key == "--seconds") {
+            c.seconds = std::atof(value);
+        } else if (key == "--buy-percent") {
+            c.buyPercent = std::min(100, std::max(0, std::atoi(value)));
+        } else {
+            std::cerr << "unknown option " << key << std::endl;
+            std::exit(1);
+        }
+    }
+    return c;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+const Clock::duration kSpin = std::chrono::microseconds(200);
+
+void worker(const Config& config, int index, Clock::time_point start,
+            Histogram& histogram, uint64_t& buys, uint64_t& sells) {
+    uint64_t rng = 0x9E3779B97F4A7C15ULL * (index + 1);
+    Clock::time_point end =
+        start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(config.seconds));
+    // 开环模式下每个线程负责 rate / threads 的到达率，各线程错开起始相位
+    Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(config.threads / config.rate));
+    Clock::time_point intended = start + interval * index / config.threads;
+
+    for (;;) {
+        Clock::time_point now = Clock::now();
+        if (config.open) {
+            if (intended >= end) break;
+            // sleep 的唤醒误差有几十微秒，最后一段改为自旋等待，
+            // 否则生成器自身的误差会被算进延迟
+            if (now + kSpin < intended) {
+                std::this_thread::sleep_until(intended - kSpin);
+            }
+            while (Clock::now() < intended) std::this_thread::yield();
+        } else {
+            if (now >= end) break;
+            intended = now;
+        }
+
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        if (static_cast<int>(rng % 100) < config.buyPercent) {
+            BuyTransaction b;
+            ++buys;
+        } else {
+            SellTransaction s;
+            ++sells;
+        }
+
+        // 开环模式下若落后于计划，下一笔仍按原计划时间计算延迟
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             Clock::now() - intended)
+                             .count());
+        if (config.open) intended += interval;
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config = parse(argc, argv);
+    std::ofstream devNull("/dev/null");
+    transactionLog = &devNull;
+
+    std::vector<Histogram> histograms(config.threads);
+    std::vector<uint64_t> buys(config.threads, 0), sells(config.threads, 0);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now() + std::chrono::milliseconds(10);
+    for (int t = 0; t < config.threads; ++t) {
+        threads.push_back(std::thread(worker, std::cref(config), t, start,
+                                      std::ref(histograms[t]),
+                                      std::ref(buys[t]), std::ref(sells[t])));
+    }
+    for (std::size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    double elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    Histogram all;
+    uint64_t totalBuys = 0, totalSells = 0;
+    for (int t = 0; t < config.threads; ++t) {
+        all.merge(histograms[t]);
+        totalBuys += buys[t];
+        totalSells += sells[t];
+    }
+
+    std::cout << "{\n"
+              << "  \"mode\": \"" << (config.open ? "open" : "closed")
+              << "\",\n"
+              << "  \"threads\": " << config.threads << ",\n";
+    if (config.open) {
+        std::cout << "  \"target_rate\": " << config.rate << ",\n";
+    }
+    std::cout << "  \"seconds\": " << elapsed << ",\n"
+              << "  \"transactions\": " << all.count() << ",\n"
+              << "  \"buys\": " << totalBuys << ",\n"
+              << "  \"sells\": " << totalSells << ",\n"
+              << "  \"throughput\": " << all.count() / elapsed << ",\n"
+              << "  \"latency_ns\": {\n"
+              << "    \"mean\": " << all.mean() << ",\n"
+              << "    \"p50\": " << all.percentile(50) << ",\n"
+              << "    \"p90\": " << all.percentile(90) << ",\n"
+              << "    \"p99\": " << all.percentile(99) << ",\n"
+              << "    \"p999\": " << all.percentile(99.9) << ",\n"
+              << "    \"max\": " << all.max() << "\n"
+              << "  }\n"
+              << "}" << std::endl;
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,3 @@
+g++ Transaction.cpp -o Transaction.out -std=c++11 -O2 -pthread
+./Transaction.out --mode closed --threads 4 --seconds 1
+./Transaction.out --mode open --threads 4 --rate 200000 --seconds 1
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 用 operator+= 对大量 A 求和的并行归约。
+//
+// 为了让结果与线程数无关（逐位相同），归约的形状是固定的：
+// - 把输入按固定大小 kBlock 切块，块内用固定的 kLanes 路累加器求和
+// - 各块的结果按下标两两合并成一棵固定形状的树
+// 线程只决定“谁来算哪一块”，不改变任何一次加法的操作数和顺序。
+// 这里的 A 存放 double：整数加法满足结合律，浮点数才会因为求和顺序不同而
+// 得到不同的结果。
+
+class A {
+public:
+    A() : m_var(0) {}
+    A(double var) : m_var(var) {}
+    A(const A& rhs) : m_var(rhs.getVar()) {}
+
+    A& operator=(const A& rhs) {
+        m_var = rhs.getVar();
+        return *this;
+    }
+
+    A& operator+=(const A& rhs) {
+        m_var += rhs.getVar();
+        return *this;
+    }
+
+    double getVar() const { return m_var; }
+
+private:
+    double m_var;
+};
+
+// 固定线程数的线程池，调用线程也参与计算
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads)
+        : generation(0), active(0), stopping(false), count(0) {
+        next.store(0);
+        for (int i = 1; i < threads; ++i) {
+            workers.push_back(std::thread(&ThreadPool::run, this));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::size_t i = 0; i < workers.size(); ++i) workers[i].join();
+    }
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // 对 [0, n) 中的每个 i 调用一次 f(i)，全部完成后返回
+    void parallelFor(std::size_t n, const std::function<void(std::size_t)>& f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = f;
+            count = n;
+            next.store(0);
+            active = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        work();
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return active == 0; });
+        job = std::function<void(std::size_t)>();
+    }
+
+private:
+    void work() {
+        for (;;) {
+            std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) return;
+            job(i);
+        }
+    }
+
+    void run() {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock,
+                          [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0) finished.notify_one();
+        }
+    }
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    uint64_t generation;
+    std::size_t active;  // 本轮还没做完的工作线程数
+    bool stopping;
+    std::function<void(std::size_t)> job;
+    std::size_t count;
+    std::atomic<std::size_t> next;
+};
+
+const std::size_t kBlock = 8192;
+const std::size_t kLanes = 8;
+
+// 块内求和：kLanes 路互不依赖的累加器，编译器可以把它们放进一个向量寄存器
+A sumBlock(const A* first, std::size_t n) {
+    A lanes[kLanes];
+    std::size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+        for (std::size_t j = 0; j < kLanes; ++j) lanes[j] += first[i + j];
+    }
+    for (; i < n; ++i) lanes[i % kLanes] += first[i];
+    for (std::size_t width = kLanes / 2; width > 0; width /= 2) {
+        for (std::size_t j = 0; j < width; ++j) lanes[j] += lanes[j + width];
+    }
+    return lanes[0];
+}
+
+// 按下标两两合并：(0,1) (2,3) ...，然后 (0,2) (4,6) ...，树的形状只取决于块数
+A combine(std::vector<A>& partial) {
+    if (partial.empty()) return A();
+    for (std::size_t stride = 1; stride < partial.size(); stride *= 2) {
+        for (std::size_t i = 0; i + stride < partial.size(); i += 2 * stride) {
+            partial[i] += partial[i + stride];
+        }
+    }
+    return partial[0];
+}
+
+// pool 为空或数据量太小时在调用线程上串行计算，结果与并行时完全相同
+A reduce(ThreadPool* pool, const A* first, const A* last) {
+    std::size_t n = last - first;
+    std::size_t blocks = (n + kBlock - 1) / kBlock;
+    std::vector<A> partial(blocks);
+    std::function<void(std::size_t)> task = [&](std::size_t b) {
+        std::size_t begin = b * kBlock;
+        std::size_t size = std::min(kBlock, n - begin);
+        partial[b] = sumBlock(first + begin, size);
+    };
+    if (pool && pool->size() > 1 && blocks >= 4) {
+        pool->parallelFor(blocks, task);
+    } else {
+        for (std::size_t b = 0; b < blocks; ++b) task(b);
+    }
+    return combine(partial);
+}
+
+uint64_t bits(double d) {
+    uint64_t u;
+    std::memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+int main() {
+    typedef std::chrono::steady_clock Clock;
+    const std::size_t n = 1 << 23;
+    std::vector<A> values;
+    values.reserve(n);
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    for (std::size_t i = 0; i < n; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        // 数量级相差很大的数，求和顺序不同时结果很容易不同
+        values.push_back(A(static_cast<double>(rng >> 11) / (1 << 20) *
+                           (i % 3 ? 1e-6 : 1e6)));
+    }
+    const A* first = values.data();
+    const A* last = first + n;
+
+    A naive;
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) naive += values[i];
+    double naiveMs =
+        std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    A serial = reduce(0, first, last);
+    double serialMs =
+        std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout.precision(17);
+    std::cout << "naive loop:     " << naive.getVar() << " (" << naiveMs
+              << " ms)" << std::endl;
+    std::cout << "serial reduce:  " << serial.getVar() << " (" << serialMs
+              << " ms)" << std::endl;
+
+    std::cout.precision(4);
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+              << std::endl;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        ThreadPool pool(threads);
+        reduce(&pool, first, last);  // 预热
+        const int rounds = 5;
+        A result;
+        start = Clock::now();
+        for (int r = 0; r < rounds; ++r) result = reduce(&pool, first, last);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                               start)
+                        .count() /
+                    rounds;
+        std::cout << threads << " threads: " << ms << " ms, speedup "
+                  << serialMs / ms << "x, "
+                  << (bits(result.getVar()) == bits(serial.getVar())
+                          ? "bit-identical"
+                          : "DIFFERENT")
+                  << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,411 @@
+#include <immintrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+// 把 BitMap 做成真正的定长位图。
+//
+// - 存储按 64 字节对齐，长度补齐到 512 位的整数倍，补齐部分始终为 0
+// - 按位运算和 popcount 在运行时选择实现：CPU 支持 AVX2 时一次处理 256 位，
+//   否则退回逐个 64 位字的循环
+// - 拷贝只是一次分配加 memcpy；Widget::operator= 仍然沿用 ex4 的写法，
+//   分配失败抛出异常时原对象保持不变
+
+enum BitOp { And, Or, Xor, AndNot };
+
+// 一组按位运算的实现，n 为 64 位字的个数
+struct Kernels {
+    void (*binary[4])(uint64_t* dst, const uint64_t* src, std::size_t n);
+    uint64_t (*popcount)(const uint64_t* words, std::size_t n);
+    uint64_t (*andPopcount)(const uint64_t* a, const uint64_t* b,
+                            std::size_t n);
+    const char* name;
+};
+
+template <int Op>
+inline uint64_t apply(uint64_t a, uint64_t b) {
+    switch (Op) {
+        case And:
+            return a & b;
+        case Or:
+            return a | b;
+        case Xor:
+            return a ^ b;
+        default:
+            return a & ~b;
+    }
+}
+
+template <int Op>
+void scalarBinary(uint64_t* dst, const uint64_t* src, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) dst[i] = apply<Op>(dst[i], src[i]);
+}
+
+uint64_t scalarPopcount(const uint64_t* words, std::size_t n) {
+    uint64_t c = 0;
+    for (std::size_t i = 0; i < n; ++i) c += __builtin_popcountll(words[i]);
+    return c;
+}
+
+uint64_t scalarAndPopcount(const uint64_t* a, const uint64_t* b,
+                           std::size_t n) {
+    uint64_t c = 0;
+    for (std::size_t i = 0; i < n; ++i) c += __builtin_popcountll(a[i] & b[i]);
+    return c;
+}
+
+// AVX2 版本要求 n 是 4 的倍数且地址 32 字节对齐，BitMap 的存储总是满足
+template <int Op>
+__attribute__((target("avx2"))) void avx2Binary(uint64_t* dst,
+                                                const uint64_t* src,
+                                                std::size_t n) {
+    for (std::size_t i = 0; i < n; i += 4) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<__m256i*>(dst + i));
+        __m256i b =
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i r;
+        switch (Op) {
+            case And:
+                r = _mm256_and_si256(a, b);
+                break;
+            case Or:
+                r = _mm256_or_si256(a, b);
+                break;
+            case Xor:
+                r = _mm256_xor_si256(a, b);
+                break;
+            default:
+                r = _mm256_andnot_si256(b, a);  // ~b & a
+                break;
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), r);
+    }
+}
+
+// 每个字节查表得到低 4 位和高 4 位中 1 的个数，再按 64 位横向求和
+__attribute__((target("avx2"))) inline __m256i popcount256(__m256i v) {
+    const __m256i table =
+        _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0,
+                         1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_and_si256(v, low);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+                                    _mm256_shuffle_epi8(table, hi));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) uint64_t sum256(__m256i v) {
+    return _mm256_extract_epi64(v, 0) + _mm256_extract_epi64(v, 1) +
+           _mm256_extract_epi64(v, 2) + _mm256_extract_epi64(v, 3);
+}
+
+__attribute__((target("avx2"))) uint64_t avx2Popcount(const uint64_t* words,
+                                                      std::size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v =
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(words + i));
+        acc = _mm256_add_epi64(acc, popcount256(v));
+    }
+    return sum256(acc) + scalarPopcount(words + i, n - i);
+}
+
+__attribute__((target("avx2"))) uint64_t avx2AndPopcount(const uint64_t* a,
+                                                         const uint64_t* b,
+                                                         std::size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    for (std::size_t i = 0; i < n; i += 4) {
+        __m256i v = _mm256_and_si256(
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(a + i)),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(b + i)));
+        acc = _mm256_add_epi64(acc, popcount256(v));
+    }
+    return sum256(acc);
+}
+
+const Kernels scalarKernels = {
+    {scalarBinary<And>, scalarBinary<Or>, scalarBinary<Xor>,
+     scalarBinary<AndNot>},
+    scalarPopcount,
+    scalarAndPopcount,
+    "scalar"};
+
+const Kernels avx2Kernels = {
+    {avx2Binary<And>, avx2Binary<Or>, avx2Binary<Xor>, avx2Binary<AndNot>},
+    avx2Popcount,
+    avx2AndPopcount,
+    "avx2"};
+
+const Kernels* bestKernels() {
+    return __builtin_cpu_supports("avx2") ? &avx2Kernels : &scalarKernels;
+}
+
+// 当前使用的实现，基准测试中会切换到标量版本做对比
+const Kernels* kernels = bestKernels();
+
+class BitMap {
+public:
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    explicit BitMap(std::size_t bits = 0)
+        : nbits(bits), nwords(wordsFor(bits)), words(allocate(nwords)) {
+        std::memset(words, 0, nwords * sizeof(uint64_t));
+    }
+
+    BitMap(const BitMap& rhs)
+        : nbits(rhs.nbits), nwords(rhs.nwords), words(allocate(nwords)) {
+        std::memcpy(words, rhs.words, nwords * sizeof(uint64_t));
+    }
+
+    BitMap& operator=(const BitMap& rhs) {
+        BitMap tmp(rhs);
+        swap(tmp);
+        return *this;
+    }
+
+    ~BitMap() { std::free(words); }
+
+    void swap(BitMap& rhs) {
+        std::swap(nbits, rhs.nbits);
+        std::swap(nwords, rhs.nwords);
+        std::swap(words, rhs.words);
+    }
+
+    std::size_t size() const { return nbits; }
+
+    void set(std::size_t i) { words[i / 64] |= 1ULL << (i % 64); }
+    void reset(std::size_t i) { words[i / 64] &= ~(1ULL << (i % 64)); }
+    bool get(std::size_t i) const { return words[i / 64] >> (i % 64) & 1; }
+
+    // 把 [first, last) 中的位全部置 1，超出范围的部分被忽略
+    void setRange(std::size_t first, std::size_t last) {
+        last = std::min(last, nbits);
+        if (first >= last) return;
+        std::size_t fw = first / 64, lw = (last - 1) / 64;
+        uint64_t head = ~0ULL << (first % 64);
+        uint64_t tail = ~0ULL >> (63 - (last - 1) % 64);
+        if (fw == lw) {
+            words[fw] |= head & tail;
+            return;
+        }
+        words[fw] |= head;
+        std::memset(words + fw + 1, 0xFF, (lw - fw - 1) * sizeof(uint64_t));
+        words[lw] |= tail;
+    }
+
+    BitMap& operator&=(const BitMap& rhs) { return combine(And, rhs); }
+    BitMap& operator|=(const BitMap& rhs) { return combine(Or, rhs); }
+    BitMap& operator^=(const BitMap& rhs) { return combine(Xor, rhs); }
+    BitMap& andNot(const BitMap& rhs) { return combine(AndNot, rhs); }
+
+    std::size_t count() const { return kernels->popcount(words, nwords); }
+
+    // |*this & rhs|，不产生中间结果
+    std::size_t intersectCount(const BitMap& rhs) const {
+        checkSize(rhs);
+        return kernels->andPopcount(words, rhs.words, nwords);
+    }
+
+    std::size_t findFirst() const { return findNext(0); }
+
+    // 大于等于 i 的第一个 1 的位置，不存在时返回 npos
+    std::size_t findNext(std::size_t i) const {
+        if (i >= nbits) return npos;
+        std::size_t w = i / 64;
+        uint64_t bits = words[w] & (~0ULL << (i % 64));
+        while (!bits) {
+            if (++w == nwords) return npos;
+            bits = words[w];
+        }
+        return w * 64 + __builtin_ctzll(bits);
+    }
+
+    // [0, i) 中 1 的个数
+    std::size_t rank(std::size_t i) const {
+        i = std::min(i, nbits);
+        std::size_t r = kernels->popcount(words, i / 64);
+        if (i % 64) r += __builtin_popcountll(words[i / 64] << (64 - i % 64));
+        return r;
+    }
+
+    // 第 k 个（从 0 开始）1 的位置，不存在时返回 npos
+    std::size_t select(std::size_t k) const {
+        for (std::size_t w = 0; w < nwords; ++w) {
+            std::size_t c = __builtin_popcountll(words[w]);
+            if (k < c) {
+                uint64_t bits = words[w];
+                for (; k > 0; --k) bits &= bits - 1;
+                return w * 64 + __builtin_ctzll(bits);
+            }
+            k -= c;
+        }
+        return npos;
+    }
+
+    void test() const {
+        std::cout << "size = " << nbits << ", count = " << count()
+                  << std::endl;
+    }
+
+private:
+    // 补齐到 8 个字（64 字节），SIMD 循环不需要处理尾部
+    static std::size_t wordsFor(std::size_t bits) {
+        return (bits + 511) / 512 * 8;
+    }
+
+    static uint64_t* allocate(std::size_t n) {
+        void* p = 0;
+        if (posix_memalign(&p, 64, std::max<std::size_t>(n, 8) * 8) != 0) {
+            throw std::bad_alloc();
+        }
+        return static_cast<uint64_t*>(p);
+    }
+
+    void checkSize(const BitMap& rhs) const {
+        if (nbits != rhs.nbits) {
+            throw std::invalid_argument("BitMap: size mismatch");
+        }
+    }
+
+    BitMap& combine(BitOp op, const BitMap& rhs) {
+        checkSize(rhs);
+        kernels->binary[op](words, rhs.words, nwords);
+        return *this;
+    }
+
+    std::size_t nbits;
+    std::size_t nwords;
+    uint64_t* words;
+};
+
+class Widget {
+public:
+    explicit Widget(std::size_t bits) : pb(new BitMap(bits)) {}
+
+    Widget(const Widget& rhs) : pb(new BitMap(*rhs.pb)) {}
+
+    ~Widget() { delete pb; }
+
+    Widget& operator=(const Widget& rhs) {
+        BitMap* pOrig = pb;  // 保存当前 pb 的副本
+        pb = new BitMap(*rhs.pb);
+        delete pOrig;  // 保证在 new 操作成功后再删除原有 pb
+        return *this;
+    }
+
+    BitMap& bitmap() { return *pb; }
+    const BitMap& bitmap() const { return *pb; }
+
+    void test() { pb->test(); }
+
+private:
+    BitMap* pb;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+        .count();
+}
+
+// 参照：不借助 BitMap，逐个 64 位字求交集大小
+std::size_t wordLoopIntersect(const std::vector<uint64_t>& a,
+                              const std::vector<uint64_t>& b) {
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        c += __builtin_popcountll(a[i] & b[i]);
+    }
+    return c;
+}
+
+int main() {
+    // 1. 基本操作
+    Widget w(1000);
+    w.bitmap().setRange(10, 300);
+    w.bitmap().set(999);
+    Widget w1(1000);
+    w1.bitmap().setRange(200, 600);
+    w.test();
+    w1.test();
+    std::cout << "intersect = " << w.bitmap().intersectCount(w1.bitmap())
+              << ", first = " << w.bitmap().findFirst()
+              << ", rank(100) = " << w.bitmap().rank(100)
+              << ", select(290) = " << w.bitmap().select(290) << std::endl;
+
+    w = w;  // 自我赋值仍然安全
+    w = w1;
+    w.test();
+
+    // 2. 交集基准：两个 1600 万位的位图，约一半的位为 1
+    const std::size_t bits = 1 << 24;
+    BitMap a(bits), b(bits);
+    std::vector<uint64_t> va(bits / 64), vb(bits / 64);
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    for (std::size_t i = 0; i < bits / 64; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            uint64_t word = rng;
+            for (int k = 0; k < 64; ++k) {
+                if (word >> k & 1) (j ? b : a).set(i * 64 + k);
+            }
+            (j ? vb : va)[i] = word;
+        }
+    }
+
+    const int rounds = 50;
+    std::size_t expected = wordLoopIntersect(va, vb);
+    Clock::time_point start = Clock::now();
+    std::size_t sink = 0;
+    for (int r = 0; r < rounds; ++r) sink += wordLoopIntersect(va, vb);
+    std::cout << "word loop:         " << elapsedNs(start) / rounds / 1e6
+              << " ms per intersect count" << std::endl;
+
+    const Kernels* all[] = {&scalarKernels, bestKernels()};
+    for (int k = 0; k < 2; ++k) {
+        kernels = all[k];
+        start = Clock::now();
+        for (int r = 0; r < rounds; ++r) sink += a.intersectCount(b);
+        double countNs = elapsedNs(start) / rounds;
+
+        BitMap c(a);
+        start = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            c &= b;
+            c |= a;
+        }
+        double opNs = elapsedNs(start) / rounds / 2;
+
+        start = Clock::now();
+        for (int r = 0; r < rounds; ++r) sink += a.count();
+        double popNs = elapsedNs(start) / rounds;
+
+        std::cout << kernels->name << " BitMap: intersectCount "
+                  << countNs / 1e6 << " ms, &=/|= " << opNs / 1e6
+                  << " ms, count " << popNs / 1e6 << " ms"
+                  << (a.intersectCount(b) == expected ? "" : " (WRONG)")
+                  << std::endl;
+    }
+
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        BitMap copy(a);
+        sink += copy.get(r);
+    }
+    std::cout << "copy " << bits / 8 / 1024 << " KiB: "
+              << elapsedNs(start) / rounds / 1e6 << " ms" << std::endl;
+    std::cout << "(checksum " << sink % 1000 << ")" << std::endl;
+
+    return 0;
+}
\ No newline at end of file
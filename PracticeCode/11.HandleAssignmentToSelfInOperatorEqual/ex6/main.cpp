@@ -0,0 +1,931 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// 稀疏或成段分布的位集合的压缩表示（roaring bitmap 的思路）。
+//
+// 32 位的值按高 16 位分块，每块 65536 个值，按块内的分布选择最省空间的容器：
+// - 数组容器：有序的 uint16_t，最多 4096 个元素
+// - 位图容器：1024 个 64 位字，固定 8 KiB
+// - 行程容器：有序的 [start, start + length] 区间
+// 交、并、差按块两两计算，结果重新挑选容器类型。
+// 序列化格式固定为小端，可以直接 mmap 后在原地读取，不做任何拷贝。
+
+namespace roaring {
+
+enum ContainerType { ArrayType = 1, BitmapType = 2, RunType = 3 };
+
+const uint32_t kArrayMax = 4096;
+const std::size_t kChunkWords = 1024;
+const std::size_t kBitmapBytes = kChunkWords * 8;
+
+struct Run {
+    uint16_t start;
+    uint16_t length;  // 区间为 [start, start + length]
+};
+
+// 容器的只读视图，数据可能来自内存中的 Container，也可能来自 mmap 的文件
+struct ContainerView {
+    ContainerType type;
+    uint32_t size;  // 数组元素个数 / 位图字数 / 区间个数
+    uint32_t cardinality;
+    const void* data;
+
+    const uint16_t* array() const { return static_cast<const uint16_t*>(data); }
+    const uint64_t* bits() const { return static_cast<const uint64_t*>(data); }
+    const Run* runs() const { return static_cast<const Run*>(data); }
+};
+
+struct Container {
+    Container() : type(ArrayType), cardinality(0) {}
+
+    ContainerView view() const {
+        ContainerView v;
+        v.type = type;
+        v.cardinality = cardinality;
+        if (type == ArrayType) {
+            v.size = array.size();
+            v.data = array.data();
+        } else if (type == BitmapType) {
+            v.size = bits.size();
+            v.data = bits.data();
+        } else {
+            v.size = runs.size();
+            v.data = runs.data();
+        }
+        return v;
+    }
+
+    std::size_t bytes() const {
+        return array.size() * 2 + bits.size() * 8 + runs.size() * 4;
+    }
+
+    ContainerType type;
+    uint32_t cardinality;
+    std::vector<uint16_t> array;
+    std::vector<uint64_t> bits;
+    std::vector<Run> runs;
+};
+
+// ---------------------------------------------------------------------------
+// 位图辅助函数，words 总是 kChunkWords 个字
+
+void setRange(uint64_t* words, uint32_t first, uint32_t last) {
+    uint32_t fw = first / 64, lw = last / 64;
+    uint64_t head = ~0ULL << (first % 64);
+    uint64_t tail = ~0ULL >> (63 - last % 64);
+    if (fw == lw) {
+        words[fw] |= head & tail;
+        return;
+    }
+    words[fw] |= head;
+    for (uint32_t i = fw + 1; i < lw; ++i) words[i] = ~0ULL;
+    words[lw] |= tail;
+}
+
+void clearRange(uint64_t* words, uint32_t first, uint32_t last) {
+    uint32_t fw = first / 64, lw = last / 64;
+    uint64_t head = ~0ULL << (first % 64);
+    uint64_t tail = ~0ULL >> (63 - last % 64);
+    if (fw == lw) {
+        words[fw] &= ~(head & tail);
+        return;
+    }
+    words[fw] &= ~head;
+    for (uint32_t i = fw + 1; i < lw; ++i) words[i] = 0;
+    words[lw] &= ~tail;
+}
+
+void orInto(const ContainerView& v, uint64_t* words) {
+    if (v.type == ArrayType) {
+        const uint16_t* a = v.array();
+        for (uint32_t i = 0; i < v.size; ++i) {
+            words[a[i] / 64] |= 1ULL << (a[i] % 64);
+        }
+    } else if (v.type == BitmapType) {
+        const uint64_t* b = v.bits();
+        for (std::size_t i = 0; i < kChunkWords; ++i) words[i] |= b[i];
+    } else {
+        const Run* r = v.runs();
+        for (uint32_t i = 0; i < v.size; ++i) {
+            setRange(words, r[i].start, r[i].start + r[i].length);
+        }
+    }
+}
+
+void andNotInto(const ContainerView& v, uint64_t* words) {
+    if (v.type == ArrayType) {
+        const uint16_t* a = v.array();
+        for (uint32_t i = 0; i < v.size; ++i) {
+            words[a[i] / 64] &= ~(1ULL << (a[i] % 64));
+        }
+    } else if (v.type == BitmapType) {
+        const uint64_t* b = v.bits();
+        for (std::size_t i = 0; i < kChunkWords; ++i) words[i] &= ~b[i];
+    } else {
+        const Run* r = v.runs();
+        for (uint32_t i = 0; i < v.size; ++i) {
+            clearRange(words, r[i].start, r[i].start + r[i].length);
+        }
+    }
+}
+
+std::vector<uint64_t> toBits(const ContainerView& v) {
+    if (v.type == BitmapType) {
+        return std::vector<uint64_t>(v.bits(), v.bits() + kChunkWords);
+    }
+    std::vector<uint64_t> words(kChunkWords, 0);
+    orInto(v, words.data());
+    return words;
+}
+
+void andInto(const ContainerView& v, uint64_t* words) {
+    if (v.type == BitmapType) {
+        const uint64_t* b = v.bits();
+        for (std::size_t i = 0; i < kChunkWords; ++i) words[i] &= b[i];
+    } else {
+        std::vector<uint64_t> mask = toBits(v);
+        for (std::size_t i = 0; i < kChunkWords; ++i) words[i] &= mask[i];
+    }
+}
+
+// 从 pos 开始的第一个 1（value == true）或 0 的位置，不存在时返回 65536
+uint32_t nextBit(const uint64_t* words, uint32_t pos, bool value) {
+    while (pos < kChunkWords * 64) {
+        uint64_t w = value ? words[pos / 64] : ~words[pos / 64];
+        w &= ~0ULL << (pos % 64);
+        if (w) return pos / 64 * 64 + __builtin_ctzll(w);
+        pos = (pos / 64 + 1) * 64;
+    }
+    return kChunkWords * 64;
+}
+
+// 按基数和区间数挑选最小的表示。选中位图时直接接管 bits 的存储
+Container fromBits(std::vector<uint64_t>& bits) {
+    const uint64_t* words = bits.data();
+    uint32_t card = 0, runCount = 0;
+    uint64_t prev = 0;
+    for (std::size_t i = 0; i < kChunkWords; ++i) {
+        card += __builtin_popcountll(words[i]);
+        // 区间起点：本位为 1 且前一位为 0
+        runCount += __builtin_popcountll(words[i] & ~(words[i] << 1 |
+                                                      prev >> 63));
+        prev = words[i];
+    }
+
+    Container c;
+    c.cardinality = card;
+    if (card == 0) return c;
+    std::size_t arrayBytes = card <= kArrayMax ? card * 2 : kBitmapBytes + 1;
+    std::size_t runBytes = runCount * 4;
+    if (runBytes < std::min(arrayBytes, kBitmapBytes)) {
+        c.type = RunType;
+        c.runs.reserve(runCount);
+        uint32_t pos = nextBit(words, 0, true);
+        while (pos < kChunkWords * 64) {
+            uint32_t end = nextBit(words, pos, false);
+            Run r = {static_cast<uint16_t>(pos),
+                     static_cast<uint16_t>(end - 1 - pos)};
+            c.runs.push_back(r);
+            pos = nextBit(words, end, true);
+        }
+    } else if (arrayBytes <= kBitmapBytes) {
+        c.type = ArrayType;
+        c.array.reserve(card);
+        for (std::size_t i = 0; i < kChunkWords; ++i) {
+            for (uint64_t w = words[i]; w; w &= w - 1) {
+                c.array.push_back(i * 64 + __builtin_ctzll(w));
+            }
+        }
+    } else {
+        c.type = BitmapType;
+        c.bits.swap(bits);
+    }
+    return c;
+}
+
+Container copyOf(const ContainerView& v) {
+    Container c;
+    c.type = v.type;
+    c.cardinality = v.cardinality;
+    if (v.type == ArrayType) {
+        c.array.assign(v.array(), v.array() + v.size);
+    } else if (v.type == BitmapType) {
+        c.bits.assign(v.bits(), v.bits() + v.size);
+    } else {
+        c.runs.assign(v.runs(), v.runs() + v.size);
+    }
+    return c;
+}
+
+// 区间运算的结果可能由大量很短的区间组成，此时换成更小的表示
+Container shrink(Container c) {
+    std::size_t best = std::min<std::size_t>(
+        kBitmapBytes, c.cardinality <= kArrayMax ? c.cardinality * 2 : ~0U);
+    if (c.runs.size() * 4 <= best) return c;
+    std::vector<uint64_t> words = toBits(c.view());
+    return fromBits(words);
+}
+
+bool contains(const ContainerView& v, uint16_t x) {
+    if (v.type == ArrayType) {
+        return std::binary_search(v.array(), v.array() + v.size, x);
+    }
+    if (v.type == BitmapType) return v.bits()[x / 64] >> (x % 64) & 1;
+    // 最后一个 start <= x 的区间
+    const Run* r = v.runs();
+    uint32_t lo = 0, hi = v.size;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (r[mid].start <= x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > 0 && x <= r[lo - 1].start + r[lo - 1].length;
+}
+
+// 保留（keep 为 true）或去掉数组 a 中同时属于 b 的元素
+Container filterArray(const ContainerView& a, const ContainerView& b,
+                      bool keep) {
+    Container c;
+    const uint16_t* p = a.array();
+    for (uint32_t i = 0; i < a.size; ++i) {
+        if (contains(b, p[i]) == keep) c.array.push_back(p[i]);
+    }
+    c.cardinality = c.array.size();
+    return c;
+}
+
+Container intersectArrays(const ContainerView& a, const ContainerView& b) {
+    const uint16_t* small = a.array();
+    const uint16_t* large = b.array();
+    uint32_t ns = a.size, nl = b.size;
+    if (ns > nl) {
+        std::swap(small, large);
+        std::swap(ns, nl);
+    }
+    Container c;
+    if (static_cast<uint64_t>(ns) * 64 < nl) {
+        // 大小悬殊时对大数组做二分查找，搜索起点单调前移
+        const uint16_t* pos = large;
+        const uint16_t* end = large + nl;
+        for (uint32_t i = 0; i < ns && pos != end; ++i) {
+            pos = std::lower_bound(pos, end, small[i]);
+            if (pos != end && *pos == small[i]) c.array.push_back(small[i]);
+        }
+    } else {
+        std::set_intersection(small, small + ns, large, large + nl,
+                              std::back_inserter(c.array));
+    }
+    c.cardinality = c.array.size();
+    return c;
+}
+
+Container intersectRuns(const ContainerView& a, const ContainerView& b) {
+    Container c;
+    c.type = RunType;
+    const Run* x = a.runs();
+    const Run* y = b.runs();
+    uint32_t i = 0, j = 0;
+    while (i < a.size && j < b.size) {
+        uint32_t xe = x[i].start + x[i].length, ye = y[j].start + y[j].length;
+        uint32_t lo = std::max(x[i].start, y[j].start);
+        uint32_t hi = std::min(xe, ye);
+        if (lo <= hi) {
+            Run r = {static_cast<uint16_t>(lo),
+                     static_cast<uint16_t>(hi - lo)};
+            c.runs.push_back(r);
+            c.cardinality += hi - lo + 1;
+        }
+        if (xe < ye) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+    return c;
+}
+
+Container uniteRuns(const ContainerView& a, const ContainerView& b) {
+    Container c;
+    c.type = RunType;
+    const Run* x = a.runs();
+    const Run* y = b.runs();
+    uint32_t i = 0, j = 0;
+    while (i < a.size || j < b.size) {
+        const Run& next = j == b.size || (i < a.size && x[i].start < y[j].start)
+                              ? x[i++]
+                              : y[j++];
+        uint32_t end = next.start + next.length;
+        if (!c.runs.empty() &&
+            next.start <= c.runs.back().start + c.runs.back().length + 1u) {
+            Run& last = c.runs.back();
+            uint32_t lastEnd = last.start + last.length;
+            if (end > lastEnd) last.length = end - last.start;
+        } else {
+            c.runs.push_back(next);
+        }
+    }
+    for (std::size_t k = 0; k < c.runs.size(); ++k) {
+        c.cardinality += c.runs[k].length + 1;
+    }
+    return c;
+}
+
+Container subtractRuns(const ContainerView& a, const ContainerView& b) {
+    Container c;
+    c.type = RunType;
+    const Run* x = a.runs();
+    const Run* y = b.runs();
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < a.size; ++i) {
+        uint32_t lo = x[i].start, hi = x[i].start + x[i].length;
+        while (j < b.size && y[j].start + y[j].length < lo) ++j;
+        // 依次挖掉与 [lo, hi] 重叠的区间
+        for (uint32_t k = j; k < b.size && y[k].start <= hi && lo <= hi;
+             ++k) {
+            if (y[k].start > lo) {
+                Run r = {static_cast<uint16_t>(lo),
+                         static_cast<uint16_t>(y[k].start - 1 - lo)};
+                c.runs.push_back(r);
+                c.cardinality += y[k].start - lo;
+            }
+            lo = std::max<uint32_t>(lo, y[k].start + y[k].length + 1);
+        }
+        if (lo <= hi) {
+            Run r = {static_cast<uint16_t>(lo),
+                     static_cast<uint16_t>(hi - lo)};
+            c.runs.push_back(r);
+            c.cardinality += hi - lo + 1;
+        }
+    }
+    return c;
+}
+
+Container intersectContainers(const ContainerView& a, const ContainerView& b) {
+    if (a.type == ArrayType && b.type == ArrayType) {
+        return intersectArrays(a, b);
+    }
+    if (a.type == ArrayType) return filterArray(a, b, true);
+    if (b.type == ArrayType) return filterArray(b, a, true);
+    if (a.type == RunType && b.type == RunType) {
+        return shrink(intersectRuns(a, b));
+    }
+    std::vector<uint64_t> words = toBits(a);
+    andInto(b, words.data());
+    return fromBits(words);
+}
+
+Container uniteContainers(const ContainerView& a, const ContainerView& b) {
+    if (a.type == ArrayType && b.type == ArrayType &&
+        a.cardinality + b.cardinality <= kArrayMax) {
+        Container c;
+        std::set_union(a.array(), a.array() + a.size, b.array(),
+                       b.array() + b.size, std::back_inserter(c.array));
+        c.cardinality = c.array.size();
+        return c;
+    }
+    if (a.type == RunType && b.type == RunType) return shrink(uniteRuns(a, b));
+    std::vector<uint64_t> words =
+        a.type == BitmapType ? toBits(a) : toBits(b);
+    orInto(a.type == BitmapType ? b : a, words.data());
+    return fromBits(words);
+}
+
+Container subtractContainers(const ContainerView& a, const ContainerView& b) {
+    if (a.type == ArrayType) return filterArray(a, b, false);
+    if (a.type == RunType && b.type == RunType) {
+        return shrink(subtractRuns(a, b));
+    }
+    std::vector<uint64_t> words = toBits(a);
+    andNotInto(b, words.data());
+    return fromBits(words);
+}
+
+// ---------------------------------------------------------------------------
+// 序列化格式（全部小端）：
+//   [magic "RBM1"][uint32 块数]
+//   每块一个 24 字节的描述：[uint16 key][uint8 类型][uint8 0][uint32 size]
+//                           [uint32 基数][uint32 0][uint64 数据偏移]
+//   各块数据按 8 字节对齐：数组为 uint16，位图为 uint64，区间为两个 uint16
+
+const char kMagic[4] = {'R', 'B', 'M', '1'};
+const std::size_t kDescriptorSize = 24;
+
+void putLE(unsigned char* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        p[i] = static_cast<unsigned char>(v >> 8 * i);
+    }
+}
+
+uint64_t getLE(const unsigned char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(p[i]) << 8 * i;
+    return v;
+}
+
+bool littleEndianHost() {
+    const uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+class RoaringBitMap {
+public:
+    // 由稠密位图构造，按每 1024 个字一块转换
+    static RoaringBitMap fromWords(const uint64_t* words, std::size_t n) {
+        RoaringBitMap r;
+        std::vector<uint64_t> chunk(kChunkWords);
+        for (std::size_t base = 0; base < n; base += kChunkWords) {
+            std::size_t len = std::min(kChunkWords, n - base);
+            std::fill(chunk.begin(), chunk.end(), 0);
+            std::copy(words + base, words + base + len, chunk.begin());
+            Container c = fromBits(chunk);
+            chunk.resize(kChunkWords);
+            if (c.cardinality) r.appendChunk(base / kChunkWords, c);
+        }
+        return r;
+    }
+
+    void add(uint32_t x) {
+        uint16_t key = x >> 16, low = x & 0xFFFF;
+        std::vector<uint16_t>::iterator it =
+            std::lower_bound(keys.begin(), keys.end(), key);
+        std::size_t i = it - keys.begin();
+        if (it == keys.end() || *it != key) {
+            keys.insert(it, key);
+            containers.insert(containers.begin() + i, Container());
+        }
+        Container& c = containers[i];
+        if (c.type == ArrayType) {
+            std::vector<uint16_t>::iterator pos =
+                std::lower_bound(c.array.begin(), c.array.end(), low);
+            if (pos != c.array.end() && *pos == low) return;
+            c.array.insert(pos, low);
+            if (++c.cardinality > kArrayMax) {
+                std::vector<uint64_t> words = toBits(c.view());
+                c = fromBits(words);
+            }
+            return;
+        }
+        if (c.type == RunType) {
+            // 逐个插入时区间容器很少是最优的，先换成位图，需要时再压缩
+            if (roaring::contains(c.view(), low)) return;
+            c.bits = toBits(c.view());
+            c.runs.clear();
+            c.type = BitmapType;
+        }
+        uint64_t& w = c.bits[low / 64];
+        if (!(w >> (low % 64) & 1)) {
+            w |= 1ULL << (low % 64);
+            ++c.cardinality;
+        }
+    }
+
+    bool contains(uint32_t x) const {
+        std::vector<uint16_t>::const_iterator it =
+            std::lower_bound(keys.begin(), keys.end(), x >> 16);
+        if (it == keys.end() || *it != x >> 16) return false;
+        return roaring::contains(containers[it - keys.begin()].view(),
+                                 x & 0xFFFF);
+    }
+
+    // 对每一块重新挑选最省空间的容器
+    void optimize() {
+        for (std::size_t i = 0; i < containers.size(); ++i) {
+            std::vector<uint64_t> words = toBits(containers[i].view());
+            containers[i] = fromBits(words);
+        }
+    }
+
+    uint64_t cardinality() const {
+        uint64_t n = 0;
+        for (std::size_t i = 0; i < containers.size(); ++i) {
+            n += containers[i].cardinality;
+        }
+        return n;
+    }
+
+    std::size_t memoryBytes() const {
+        std::size_t n = keys.size() * (sizeof(uint16_t) + sizeof(Container));
+        for (std::size_t i = 0; i < containers.size(); ++i) {
+            n += containers[i].bytes();
+        }
+        return n;
+    }
+
+    // 追加一块，key 必须大于已有的所有 key；c 的内容会被移走
+    void appendChunk(uint16_t key, Container& c) {
+        keys.push_back(key);
+        containers.push_back(Container());
+        containers.back().type = c.type;
+        containers.back().cardinality = c.cardinality;
+        containers.back().array.swap(c.array);
+        containers.back().bits.swap(c.bits);
+        containers.back().runs.swap(c.runs);
+    }
+
+    std::size_t chunkCount() const { return keys.size(); }
+    uint16_t keyAt(std::size_t i) const { return keys[i]; }
+    ContainerView containerAt(std::size_t i) const {
+        return containers[i].view();
+    }
+
+    std::vector<unsigned char> serialize() const {
+        std::size_t header = 8 + keys.size() * kDescriptorSize;
+        std::vector<unsigned char> out((header + 7) / 8 * 8, 0);
+        std::memcpy(&out[0], kMagic, sizeof(kMagic));
+        putLE(&out[4], keys.size(), 4);
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            const Container& c = containers[i];
+            ContainerView v = c.view();
+            std::size_t offset = out.size();
+            unsigned char* d = &out[8 + i * kDescriptorSize];
+            putLE(d, keys[i], 2);
+            d[2] = static_cast<unsigned char>(c.type);
+            putLE(d + 4, v.size, 4);
+            putLE(d + 8, c.cardinality, 4);
+            putLE(d + 16, offset, 8);
+
+            out.resize(offset + (c.bytes() + 7) / 8 * 8, 0);
+            unsigned char* p = &out[offset];
+            for (std::size_t k = 0; k < c.array.size(); ++k, p += 2) {
+                putLE(p, c.array[k], 2);
+            }
+            for (std::size_t k = 0; k < c.bits.size(); ++k, p += 8) {
+                putLE(p, c.bits[k], 8);
+            }
+            for (std::size_t k = 0; k < c.runs.size(); ++k, p += 4) {
+                putLE(p, c.runs[k].start, 2);
+                putLE(p + 2, c.runs[k].length, 2);
+            }
+        }
+        return out;
+    }
+
+private:
+    std::vector<uint16_t> keys;
+    std::vector<Container> containers;
+};
+
+// 在序列化数据上原地读取。构造时检查整个头部，之后的访问不再做边界检查。
+// 数据直接按本机字节序解释，所以只支持小端机器
+class RoaringView {
+public:
+    RoaringView(const void* data_, std::size_t length)
+        : data(static_cast<const unsigned char*>(data_)), count(0) {
+        if (!littleEndianHost()) {
+            throw std::runtime_error("RoaringView: big-endian host");
+        }
+        if (length < 8 || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error("RoaringView: bad magic");
+        }
+        if (reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+            throw std::runtime_error("RoaringView: misaligned buffer");
+        }
+        count = getLE(data + 4, 4);
+        if (count > 65536 || 8 + count * kDescriptorSize > length) {
+            throw std::runtime_error("RoaringView: truncated header");
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const unsigned char* d = descriptor(i);
+            uint32_t size = getLE(d + 4, 4);
+            uint32_t card = getLE(d + 8, 4);
+            uint64_t offset = getLE(d + 16, 8);
+            std::size_t bytes;
+            switch (d[2]) {
+                case ArrayType:
+                    bytes = size * 2;
+                    if (size != card || size > kArrayMax) bytes = ~0U;
+                    break;
+                case BitmapType:
+                    bytes = size == kChunkWords ? kBitmapBytes : ~0U;
+                    break;
+                case RunType:
+                    bytes = size <= 32768 ? size * 4 : ~0U;
+                    break;
+                default:
+                    bytes = ~0U;
+            }
+            if (bytes == ~0U || card > 65536 || offset % 8 != 0 ||
+                offset > length || bytes > length - offset ||
+                (i > 0 && getLE(d, 2) <= keyAt(i - 1))) {
+                throw std::runtime_error("RoaringView: corrupt container");
+            }
+            if (d[2] == RunType && !validRuns(data + offset, size)) {
+                throw std::runtime_error("RoaringView: corrupt runs");
+            }
+        }
+    }
+
+    std::size_t chunkCount() const { return count; }
+    uint16_t keyAt(std::size_t i) const { return getLE(descriptor(i), 2); }
+
+    ContainerView containerAt(std::size_t i) const {
+        const unsigned char* d = descriptor(i);
+        ContainerView v;
+        v.type = static_cast<ContainerType>(d[2]);
+        v.size = getLE(d + 4, 4);
+        v.cardinality = getLE(d + 8, 4);
+        v.data = data + getLE(d + 16, 8);
+        return v;
+    }
+
+    uint64_t cardinality() const {
+        uint64_t n = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            n += getLE(descriptor(i) + 8, 4);
+        }
+        return n;
+    }
+
+private:
+    // setRange/clearRange 不做边界检查，所以每个区间都不能超出 chunk，
+    // 并且要有序、互不重叠
+    static bool validRuns(const unsigned char* p, uint32_t size) {
+        uint32_t next = 0;  // 下一个区间最小的起点
+        for (uint32_t i = 0; i < size; ++i, p += 4) {
+            uint32_t start = getLE(p, 2);
+            uint32_t last = start + getLE(p + 2, 2);
+            if (start < next || last > 65535) return false;
+            next = last + 1;
+        }
+        return true;
+    }
+
+    const unsigned char* descriptor(std::size_t i) const {
+        return data + 8 + i * kDescriptorSize;
+    }
+
+    const unsigned char* data;
+    std::size_t count;
+};
+
+// 交、并、差。两边可以是 RoaringBitMap 或 RoaringView 的任意组合
+template <typename L, typename R>
+RoaringBitMap intersect(const L& a, const R& b) {
+    RoaringBitMap out;
+    std::size_t i = 0, j = 0;
+    while (i < a.chunkCount() && j < b.chunkCount()) {
+        if (a.keyAt(i) < b.keyAt(j)) {
+            ++i;
+        } else if (b.keyAt(j) < a.keyAt(i)) {
+            ++j;
+        } else {
+            Container c = intersectContainers(a.containerAt(i),
+                                              b.containerAt(j));
+            if (c.cardinality) out.appendChunk(a.keyAt(i), c);
+            ++i;
+            ++j;
+        }
+    }
+    return out;
+}
+
+template <typename L, typename R>
+RoaringBitMap unite(const L& a, const R& b) {
+    RoaringBitMap out;
+    std::size_t i = 0, j = 0;
+    while (i < a.chunkCount() || j < b.chunkCount()) {
+        Container c;
+        if (j == b.chunkCount() ||
+            (i < a.chunkCount() && a.keyAt(i) < b.keyAt(j))) {
+            c = copyOf(a.containerAt(i));
+            out.appendChunk(a.keyAt(i++), c);
+        } else if (i == a.chunkCount() || b.keyAt(j) < a.keyAt(i)) {
+            c = copyOf(b.containerAt(j));
+            out.appendChunk(b.keyAt(j++), c);
+        } else {
+            c = uniteContainers(a.containerAt(i), b.containerAt(j));
+            out.appendChunk(a.keyAt(i), c);
+            ++i;
+            ++j;
+        }
+    }
+    return out;
+}
+
+template <typename L, typename R>
+RoaringBitMap subtract(const L& a, const R& b) {
+    RoaringBitMap out;
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < a.chunkCount(); ++i) {
+        while (j < b.chunkCount() && b.keyAt(j) < a.keyAt(i)) ++j;
+        Container c = j < b.chunkCount() && b.keyAt(j) == a.keyAt(i)
+                          ? subtractContainers(a.containerAt(i),
+                                               b.containerAt(j))
+                          : copyOf(a.containerAt(i));
+        if (c.cardinality) out.appendChunk(a.keyAt(i), c);
+    }
+    return out;
+}
+
+}  // namespace roaring
+
+// 只读映射整个文件
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : base(0), length(0) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("MappedFile: cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            throw std::runtime_error("MappedFile: cannot stat " + path);
+        }
+        length = st.st_size;
+        base = ::mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("MappedFile: mmap failed");
+        }
+    }
+
+    ~MappedFile() { ::munmap(base, length); }
+
+    const void* data() const { return base; }
+    std::size_t size() const { return length; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    void* base;
+    std::size_t length;
+};
+
+// ---------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t kUniverse = 1 << 28;
+const std::size_t kWords = kUniverse / 64;
+
+struct Rng {
+    explicit Rng(uint64_t seed) : s(seed) {}
+    uint64_t next() {
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        return s;
+    }
+    uint64_t s;
+};
+
+void makeSparse(std::vector<uint64_t>& words, Rng& rng) {
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t x = rng.next() % kUniverse;
+        words[x / 64] |= 1ULL << (x % 64);
+    }
+}
+
+void makeRuns(std::vector<uint64_t>& words, Rng& rng) {
+    for (int i = 0; i < 2000; ++i) {
+        uint64_t first = rng.next() % kUniverse;
+        uint64_t last =
+            std::min<uint64_t>(kUniverse, first + rng.next() % 100000);
+        for (uint64_t x = first; x < last; ++x) {
+            words[x / 64] |= 1ULL << (x % 64);
+        }
+    }
+}
+
+void makeDense(std::vector<uint64_t>& words, Rng& rng) {
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        words[i] = rng.next() & rng.next();
+    }
+}
+
+uint64_t denseOp(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b,
+                 std::vector<uint64_t>& out, int op) {
+    uint64_t card = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        uint64_t w = op == 0 ? a[i] & b[i] : op == 1 ? a[i] | b[i]
+                                                     : a[i] & ~b[i];
+        out[i] = w;
+        card += __builtin_popcountll(w);
+    }
+    return card;
+}
+
+template <typename F>
+double timeMs(F f, int rounds) {
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; ++r) f();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+               .count() /
+           rounds;
+}
+
+void containerMix(const roaring::RoaringBitMap& r, int counts[4]) {
+    counts[1] = counts[2] = counts[3] = 0;
+    for (std::size_t i = 0; i < r.chunkCount(); ++i) {
+        ++counts[r.containerAt(i).type];
+    }
+}
+
+void benchmark(const char* name,
+               void (*make)(std::vector<uint64_t>&, Rng&)) {
+    const int rounds = 5;
+    Rng rng(0x9E3779B97F4A7C15ULL);
+    std::vector<uint64_t> da(kWords, 0), db(kWords, 0), dout(kWords);
+    make(da, rng);
+    make(db, rng);
+
+    roaring::RoaringBitMap ra = roaring::RoaringBitMap::fromWords(
+        da.data(), da.size());
+    roaring::RoaringBitMap rb = roaring::RoaringBitMap::fromWords(
+        db.data(), db.size());
+
+    const std::string path = "/tmp/effective-cpp-item11-ex6.rbm";
+    {
+        std::vector<unsigned char> bytes = rb.serialize();
+        std::ofstream out(path.c_str(), std::ios::binary);
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    MappedFile file(path);
+    roaring::RoaringView mb(file.data(), file.size());
+
+    int mix[4];
+    containerMix(ra, mix);
+    std::cout << name << ": " << ra.cardinality() << " values, "
+              << mix[roaring::ArrayType] << " array / "
+              << mix[roaring::BitmapType] << " bitmap / "
+              << mix[roaring::RunType] << " run containers" << std::endl;
+    std::cout << "  memory: dense " << kWords * 8 / 1024 << " KiB, roaring "
+              << ra.memoryBytes() / 1024 << " KiB, serialized "
+              << file.size() / 1024 << " KiB" << std::endl;
+
+    const char* ops[] = {"and", "or", "andnot"};
+    for (int op = 0; op < 3; ++op) {
+        uint64_t expected = 0, got = 0, mapped = 0;
+        double dense = timeMs([&] { expected = denseOp(da, db, dout, op); },
+                              rounds);
+        double roar = timeMs(
+            [&] {
+                got = op == 0   ? roaring::intersect(ra, rb).cardinality()
+                      : op == 1 ? roaring::unite(ra, rb).cardinality()
+                                : roaring::subtract(ra, rb).cardinality();
+            },
+            rounds);
+        double view = timeMs(
+            [&] {
+                mapped = op == 0   ? roaring::intersect(ra, mb).cardinality()
+                         : op == 1 ? roaring::unite(ra, mb).cardinality()
+                                   : roaring::subtract(ra, mb).cardinality();
+            },
+            rounds);
+        std::cout << "  " << ops[op] << ": dense " << dense << " ms, roaring "
+                  << roar << " ms, roaring x mmap " << view << " ms"
+                  << (got == expected && mapped == expected ? ""
+                                                            : " (MISMATCH)")
+                  << std::endl;
+    }
+    ::unlink(path.c_str());
+}
+
+int main() {
+    // 1. 基本用法
+    roaring::RoaringBitMap small;
+    for (uint32_t x = 0; x < 100; x += 3) small.add(x);
+    for (uint32_t x = 70000; x < 80000; ++x) small.add(x);
+    small.optimize();
+    std::cout << "cardinality " << small.cardinality() << ", contains(99) "
+              << small.contains(99) << ", contains(75000) "
+              << small.contains(75000) << ", contains(80000) "
+              << small.contains(80000) << ", " << small.memoryBytes()
+              << " bytes" << std::endl;
+
+    // 损坏的区间在构造视图时就被拒绝：把 [70000, 80000) 的长度改成 65535
+    std::vector<unsigned char> bytes = small.serialize();
+    const unsigned char* d = &bytes[8 + roaring::kDescriptorSize];
+    uint64_t offset = 0;
+    std::memcpy(&offset, d + 16, sizeof(offset));
+    bytes[offset + 2] = bytes[offset + 3] = 0xFF;
+    try {
+        roaring::RoaringView view(bytes.data(), bytes.size());
+    } catch (const std::exception& e) {
+        std::cout << "exception caught: " << e.what() << std::endl;
+    }
+
+    // 2. 与 2^28 位的稠密位图对比
+    benchmark("sparse", makeSparse);
+    benchmark("runs", makeRuns);
+    benchmark("dense", makeDense);
+
+    return 0;
+}
\ No newline at end of file
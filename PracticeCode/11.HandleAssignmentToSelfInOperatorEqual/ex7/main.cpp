@@ -0,0 +1,210 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// 写时复制：多个 Widget 通过原子引用计数共享同一个不可变的 BitMap，
+// 只有在第一次修改时才复制一份。
+//
+// 强异常安全保证仍然成立：
+// - 赋值只调整引用计数，不会抛出异常，自我赋值也安全
+// - 修改前的复制可能抛出异常，此时 Widget 仍指向原来的 BitMap
+
+class BitMap {
+public:
+    explicit BitMap(std::size_t bits) : words((bits + 63) / 64, 0) {}
+
+    BitMap(const BitMap& rhs) : words() {
+        if (failNextCopy) {
+            failNextCopy = false;
+            throw std::runtime_error("BitMap copy failed");
+        }
+        words = rhs.words;
+        copies.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void set(std::size_t i) { words[i / 64] |= 1ULL << (i % 64); }
+
+    std::size_t count() const {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            n += __builtin_popcountll(words[i]);
+        }
+        return n;
+    }
+
+    void test() const { std::cout << "count = " << count() << std::endl; }
+
+    static std::atomic<uint64_t> copies;
+    static bool failNextCopy;  // 用于演示复制失败
+
+private:
+    BitMap& operator=(const BitMap&);
+
+    std::vector<uint64_t> words;
+};
+
+std::atomic<uint64_t> BitMap::copies(0);
+bool BitMap::failNextCopy = false;
+
+// ex4 的写法：每次赋值都深拷贝
+class Widget {
+public:
+    explicit Widget(std::size_t bits) : pb(new BitMap(bits)) {}
+
+    Widget(const Widget& rhs) : pb(new BitMap(*rhs.pb)) {}
+
+    ~Widget() { delete pb; }
+
+    Widget& operator=(const Widget& rhs) {
+        BitMap* pOrig = pb;  // 保存当前 pb 的副本
+        pb = new BitMap(*rhs.pb);
+        delete pOrig;  // 保证在 new 操作成功后再删除原有 pb
+        return *this;
+    }
+
+    void set(std::size_t i) { pb->set(i); }
+    const BitMap& bitmap() const { return *pb; }
+    void test() const { pb->test(); }
+
+private:
+    BitMap* pb;
+};
+
+// 写时复制的版本
+class CowWidget {
+public:
+    explicit CowWidget(std::size_t bits) : rep(new Rep(bits)) {}
+
+    CowWidget(const CowWidget& rhs) : rep(rhs.rep) { acquire(rep); }
+
+    ~CowWidget() { release(rep); }
+
+    CowWidget& operator=(const CowWidget& rhs) {
+        Rep* pOrig = rep;
+        acquire(rhs.rep);  // 先增加新引用再释放旧引用，自我赋值时计数不会归零
+        rep = rhs.rep;
+        release(pOrig);
+        return *this;
+    }
+
+    void set(std::size_t i) { mutableBitMap().set(i); }
+    const BitMap& bitmap() const { return rep->bitmap; }
+    void test() const { rep->bitmap.test(); }
+
+    bool shared() const {
+        return rep->refs.load(std::memory_order_acquire) != 1;
+    }
+
+private:
+    struct Rep {
+        explicit Rep(std::size_t bits) : refs(1), bitmap(bits) {}
+        explicit Rep(const BitMap& b) : refs(1), bitmap(b) {}
+
+        std::atomic<int> refs;
+        BitMap bitmap;
+    };
+
+    static void acquire(Rep* r) {
+        r->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // acq_rel 保证其它线程之前对 Rep 的读取都发生在 delete 之前
+    static void release(Rep* r) {
+        if (r->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete r;
+    }
+
+    // 只有一个引用时可以直接修改：其它线程只能通过复制本对象才能增加
+    // 引用，而同时复制和修改同一个 Widget 本来就是数据竞争
+    BitMap& mutableBitMap() {
+        if (shared()) {
+            Rep* copy = new Rep(rep->bitmap);  // 抛出异常时 rep 保持不变
+            release(rep);
+            rep = copy;
+        }
+        return rep->bitmap;
+    }
+
+    Rep* rep;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// 流水线：不断把源对象赋值给各个阶段，偶尔修改其中一个
+template <typename W>
+double pipeline(std::size_t bits, int rounds, int writeEvery) {
+    W source(bits);
+    source.set(1);
+    std::vector<W> stages(64, W(bits));
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        W& stage = stages[r % stages.size()];
+        stage = source;
+        if (r % writeEvery == 0) stage.set(r % bits);
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+               .count() /
+           rounds;
+}
+
+int main() {
+    // 1. 共享与第一次修改
+    CowWidget w(1024);
+    w.set(3);
+    CowWidget w1 = w;
+    w = w;  // 自我赋值
+    std::cout << "after copy, shared: " << w.shared() << ", copies "
+              << BitMap::copies << std::endl;
+    w1.set(5);
+    std::cout << "after write, shared: " << w.shared() << ", copies "
+              << BitMap::copies << std::endl;
+    w.test();
+    w1.test();
+
+    // 2. 修改前的复制失败时对象保持原样
+    CowWidget w2 = w;
+    BitMap::failNextCopy = true;
+    try {
+        w2.set(7);
+    } catch (const std::exception& e) {
+        std::cout << "exception caught: " << e.what() << std::endl;
+    }
+    std::cout << "w2 still shared: " << w2.shared() << ", ";
+    w2.test();
+
+    // 3. 多个线程各自复制同一个共享对象并修改自己的副本
+    {
+        const CowWidget shared(4096);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.push_back(std::thread([&shared, t] {
+                for (int i = 0; i < 10000; ++i) {
+                    CowWidget local = shared;
+                    if (i % 100 == 0) local.set(t);
+                }
+            }));
+        }
+        for (std::size_t t = 0; t < threads.size(); ++t) threads[t].join();
+        std::cout << "shared after threads: " << shared.bitmap().count()
+                  << " bits set" << std::endl;
+    }
+
+    // 4. 复制多、修改少的流水线
+    const std::size_t bits = 1 << 16;
+    const int rounds = 200000;
+    const int writeEvery = 100;
+    BitMap::copies = 0;
+    double deep = pipeline<Widget>(bits, rounds, writeEvery);
+    uint64_t deepCopies = BitMap::copies.exchange(0);
+    double cow = pipeline<CowWidget>(bits, rounds, writeEvery);
+    uint64_t cowCopies = BitMap::copies.exchange(0);
+    std::cout << "deep copy:     " << deep << " ns/assignment, " << deepCopies
+              << " BitMap copies" << std::endl;
+    std::cout << "copy-on-write: " << cow << " ns/assignment, " << cowCopies
+              << " BitMap copies" << std::endl;
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,311 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// 读者无锁的并发 Widget。
+//
+// ex4 的 operator= 在 new 成功后立刻 delete 旧的 BitMap，如果其它线程此时
+// 正在读旧对象就会访问已释放的内存。这里写者用原子交换发布新的 BitMap，
+// 旧对象交给基于 epoch 的回收器：等所有可能还在读它的读者都离开之后再释放。
+// 读者只需要记录一次当前 epoch，不加锁也不自旋。
+
+class BitMap {
+public:
+    explicit BitMap(uint64_t seed) {
+        for (int i = 0; i < 8; ++i) words[i] = seed * (i + 1);
+    }
+
+    BitMap(const BitMap& rhs) {
+        for (int i = 0; i < 8; ++i) words[i] = rhs.words[i];
+    }
+
+    uint64_t count() const {
+        uint64_t n = 0;
+        for (int i = 0; i < 8; ++i) n += __builtin_popcountll(words[i]);
+        return n;
+    }
+
+    void test() const { std::cout << "count = " << count() << std::endl; }
+
+private:
+    BitMap& operator=(const BitMap&);
+
+    uint64_t words[8];
+};
+
+// 基于 epoch 的内存回收。
+//
+// - 读者进入临界区时把当前全局 epoch 写到自己线程的槽里，离开时清零
+// - 被替换下来的对象记下退休时的全局 epoch e
+// - 只有当所有活跃读者都已看到当前 epoch 时全局 epoch 才能前进；
+//   全局 epoch 到达 e + 2 时，不可能再有读者持有该对象，可以释放
+class EpochDomain {
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch;  // 0 表示不在临界区内
+        std::atomic<bool> used;
+        int depth;  // 嵌套深度，只由持有该槽的线程访问
+    };
+
+public:
+    static const int kMaxThreads = 256;
+
+    EpochDomain() : global(1), retiredCount(0), freedCount(0) {
+        for (int i = 0; i < kMaxThreads; ++i) {
+            slots[i].epoch.store(0);
+            slots[i].used.store(false);
+            slots[i].depth = 0;
+        }
+    }
+
+    // 调用者保证此时已经没有读者
+    ~EpochDomain() {
+        for (std::size_t i = 0; i < retired.size(); ++i) {
+            retired[i].deleter(retired[i].object);
+        }
+    }
+
+    class Guard {
+    public:
+        explicit Guard(EpochDomain& domain) : slot(domain.localSlot()) {
+            if (slot->depth++ == 0) {
+                // acquire：读到的 epoch 不会比它之前已退休的对象更旧。
+                // seq_cst：写者回收前一定能看到本线程的 epoch，
+                // 否则本线程随后读到的必然是新指针
+                uint64_t e = domain.global.load(std::memory_order_acquire);
+                slot->epoch.store(e, std::memory_order_seq_cst);
+            }
+        }
+
+        ~Guard() {
+            if (--slot->depth == 0) {
+                slot->epoch.store(0, std::memory_order_release);
+            }
+        }
+
+    private:
+        Guard(const Guard&);
+        Guard& operator=(const Guard&);
+
+        Slot* slot;
+    };
+
+    template <typename T>
+    void retire(T* object) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Retired r = {object, &deleteAs<T>,
+                     global.load(std::memory_order_relaxed)};
+        retired.push_back(r);
+        ++retiredCount;
+        if (retired.size() >= kCollectThreshold) collect();
+    }
+
+    // 尽量推进 epoch 并释放可以释放的对象
+    void collect() {
+        uint64_t e = global.load(std::memory_order_relaxed);
+        bool quiescent = true;
+        for (int i = 0; i < kMaxThreads && quiescent; ++i) {
+            uint64_t s = slots[i].epoch.load(std::memory_order_seq_cst);
+            if (s != 0 && s != e) quiescent = false;
+        }
+        if (quiescent) global.store(++e, std::memory_order_release);
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < retired.size(); ++i) {
+            if (retired[i].epoch + 2 <= e) {
+                retired[i].deleter(retired[i].object);
+                ++freedCount;
+            } else {
+                retired[kept++] = retired[i];
+            }
+        }
+        retired.resize(kept);
+    }
+
+    uint64_t retiredObjects() const { return retiredCount; }
+    uint64_t freedObjects() const { return freedCount; }
+
+private:
+    struct Retired {
+        void* object;
+        void (*deleter)(void*);
+        uint64_t epoch;
+    };
+
+    // 每个线程第一次进入临界区时占用一个槽，线程退出时归还
+    struct LocalSlot {
+        LocalSlot() : slot(0) {}
+        ~LocalSlot() {
+            if (slot) slot->used.store(false, std::memory_order_release);
+        }
+        Slot* slot;
+    };
+
+    Slot* localSlot() {
+        static thread_local LocalSlot local;
+        if (local.slot) return local.slot;
+        for (int i = 0; i < kMaxThreads; ++i) {
+            bool expected = false;
+            if (!slots[i].used.load(std::memory_order_relaxed) &&
+                slots[i].used.compare_exchange_strong(expected, true)) {
+                local.slot = &slots[i];
+                return local.slot;
+            }
+        }
+        throw std::runtime_error("EpochDomain: too many threads");
+    }
+
+    template <typename T>
+    static void deleteAs(void* p) {
+        delete static_cast<T*>(p);
+    }
+
+    static const std::size_t kCollectThreshold = 64;
+
+    EpochDomain(const EpochDomain&);
+    EpochDomain& operator=(const EpochDomain&);
+
+    Slot slots[kMaxThreads];
+    std::atomic<uint64_t> global;
+    std::mutex mutex;  // 只有写者（退休和回收）会用到
+    std::vector<Retired> retired;
+    uint64_t retiredCount;
+    uint64_t freedCount;
+};
+
+// 每个线程只能占用一个槽，所以整个程序共用一个回收域
+EpochDomain& epochDomain() {
+    static EpochDomain domain;
+    return domain;
+}
+
+class ConcurrentWidget {
+public:
+    explicit ConcurrentWidget(uint64_t seed) : pb(new BitMap(seed)) {}
+
+    ~ConcurrentWidget() { delete pb.load(); }
+
+    // 先复制再发布，复制抛出异常时什么都没有改变
+    ConcurrentWidget& operator=(const ConcurrentWidget& rhs) {
+        BitMap* copy;
+        {
+            EpochDomain::Guard guard(epochDomain());
+            copy = new BitMap(*rhs.pb.load(std::memory_order_seq_cst));
+        }
+        publish(copy);
+        return *this;
+    }
+
+    void reset(uint64_t seed) { publish(new BitMap(seed)); }
+
+    uint64_t count() const {
+        EpochDomain::Guard guard(epochDomain());
+        return pb.load(std::memory_order_seq_cst)->count();
+    }
+
+    void test() const {
+        EpochDomain::Guard guard(epochDomain());
+        pb.load(std::memory_order_seq_cst)->test();
+    }
+
+private:
+    ConcurrentWidget(const ConcurrentWidget&);
+
+    void publish(BitMap* next) {
+        BitMap* pOrig = pb.exchange(next, std::memory_order_seq_cst);
+        epochDomain().retire(pOrig);  // 读者可能还在使用，不能直接 delete
+    }
+
+    std::atomic<BitMap*> pb;
+};
+
+// 对照组：ex4 的 Widget 加一把互斥锁，读写都要加锁
+class MutexWidget {
+public:
+    explicit MutexWidget(uint64_t seed) : pb(new BitMap(seed)) {}
+
+    ~MutexWidget() { delete pb; }
+
+    void reset(uint64_t seed) {
+        BitMap* next = new BitMap(seed);
+        std::lock_guard<std::mutex> lock(mutex);
+        BitMap* pOrig = pb;
+        pb = next;
+        delete pOrig;
+    }
+
+    uint64_t count() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pb->count();
+    }
+
+private:
+    MutexWidget(const MutexWidget&);
+    MutexWidget& operator=(const MutexWidget&);
+
+    mutable std::mutex mutex;
+    BitMap* pb;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// readers 个读者线程不停地读，一个写者线程每隔 50 微秒替换一次
+template <typename W>
+double readsPerSecond(int readers) {
+    W widget(1);
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.push_back(std::thread([&] {
+            uint64_t n = 0, sink = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                sink += widget.count();
+                ++n;
+            }
+            reads.fetch_add(n + (sink == 1));
+        }));
+    }
+    std::thread writer([&] {
+        for (uint64_t seed = 2; !stop.load(std::memory_order_relaxed);
+             ++seed) {
+            widget.reset(seed);
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+    Clock::time_point start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    stop.store(true);
+    for (std::size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    writer.join();
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    return reads.load() / seconds;
+}
+
+int main() {
+    ConcurrentWidget w(2);
+    ConcurrentWidget w1(3);
+    w.test();
+    w = w;  // 自我赋值：复制后发布，旧对象延迟回收
+    w = w1;
+    w.test();
+
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+              << std::endl;
+    for (int readers = 1; readers <= 64; readers *= 2) {
+        double epoch = readsPerSecond<ConcurrentWidget>(readers);
+        double locked = readsPerSecond<MutexWidget>(readers);
+        std::cout << readers << " readers: epoch " << epoch / 1e6
+                  << " M reads/s, mutex " << locked / 1e6 << " M reads/s"
+                  << std::endl;
+    }
+    std::cout << "retired " << epochDomain().retiredObjects() << ", freed "
+              << epochDomain().freedObjects() << " BitMaps" << std::endl;
+
+    return 0;
+}
\ No newline at end of file
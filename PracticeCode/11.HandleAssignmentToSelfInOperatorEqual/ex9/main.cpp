@@ -0,0 +1,247 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <utility>
+
+// 小对象内联存储：BitMap 不超过 kInlineBytes 时直接放在 Widget 内部的缓冲区中，
+// 超过时才从堆上分配。
+//
+// BitMap 的布局是一个头部后面紧跟着位数据，拷贝就是一次 memcpy，不会失败。
+// 因此 Widget 的各种拷贝、赋值中只有堆分配可能抛出异常，只要在分配成功之前
+// 不修改任何状态，就能保证强异常安全。
+
+// 堆分配都经过这里，便于统计次数
+uint64_t allocations = 0;
+
+void* heapAllocate(std::size_t bytes) {
+    ++allocations;
+    return ::operator new(bytes);
+}
+
+void heapFree(void* p) { ::operator delete(p); }
+
+class BitMap {
+public:
+    static std::size_t bytesFor(std::size_t bits) {
+        return sizeof(BitMap) + (bits + 63) / 64 * sizeof(uint64_t);
+    }
+
+    // 在 memory 处构造一个全 0 的位图，memory 至少要有 bytesFor(bits) 字节
+    static BitMap* create(void* memory, std::size_t bits) {
+        BitMap* b = new (memory) BitMap(bits);
+        std::memset(b->words(), 0, b->bytes() - sizeof(BitMap));
+        return b;
+    }
+
+    // 把 rhs 连同位数据一起复制到 memory 处，两者不能重叠
+    static BitMap* copy(void* memory, const BitMap& rhs) {
+        std::memcpy(memory, &rhs, rhs.bytes());
+        return static_cast<BitMap*>(memory);
+    }
+
+    std::size_t size() const { return nbits; }
+    std::size_t bytes() const { return bytesFor(nbits); }
+
+    void set(std::size_t i) { words()[i / 64] |= 1ULL << (i % 64); }
+    bool get(std::size_t i) const { return words()[i / 64] >> (i % 64) & 1; }
+
+    std::size_t count() const {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < (nbits + 63) / 64; ++i) {
+            n += __builtin_popcountll(words()[i]);
+        }
+        return n;
+    }
+
+    void test() const {
+        std::cout << "size = " << nbits << ", count = " << count()
+                  << std::endl;
+    }
+
+private:
+    explicit BitMap(std::size_t bits) : nbits(bits) {}
+
+    uint64_t* words() { return reinterpret_cast<uint64_t*>(this + 1); }
+    const uint64_t* words() const {
+        return reinterpret_cast<const uint64_t*>(this + 1);
+    }
+
+    std::size_t nbits;
+};
+
+class Widget {
+public:
+    // 头部 8 字节，内联时最多存放 (64 - 8) * 8 = 448 位
+    static const std::size_t kInlineBytes = 64;
+
+    explicit Widget(std::size_t bits = 0) : pb(0), capacity(0) {
+        pb = BitMap::create(allocate(BitMap::bytesFor(bits)), bits);
+    }
+
+    Widget(const Widget& rhs) : pb(0), capacity(0) {
+        pb = BitMap::copy(allocate(rhs.pb->bytes()), *rhs.pb);
+    }
+
+    // 移动之后 rhs 是一个 0 位的内联位图
+    Widget(Widget&& rhs) noexcept : pb(0), capacity(0) { steal(rhs); }
+
+    ~Widget() {
+        if (onHeap()) heapFree(pb);
+    }
+
+    Widget& operator=(const Widget& rhs) {
+        if (this == &rhs) return *this;  // memcpy 不允许源和目标重叠
+        std::size_t bytes = rhs.pb->bytes();
+        if (bytes <= kInlineBytes) {
+            // 放得进内联缓冲区：释放堆内存不会失败
+            if (onHeap()) heapFree(pb);
+            pb = BitMap::copy(buffer, *rhs.pb);
+            capacity = kInlineBytes;
+        } else if (onHeap() && bytes <= capacity) {
+            pb = BitMap::copy(pb, *rhs.pb);  // 复用已有的堆内存
+        } else {
+            void* memory = heapAllocate(bytes);  // 失败时什么都没有改变
+            BitMap* pOrig = pb;
+            bool wasOnHeap = onHeap();
+            pb = BitMap::copy(memory, *rhs.pb);
+            capacity = bytes;
+            if (wasOnHeap) heapFree(pOrig);
+        }
+        return *this;
+    }
+
+    Widget& operator=(Widget&& rhs) noexcept {
+        if (this == &rhs) return *this;
+        if (onHeap()) heapFree(pb);
+        steal(rhs);
+        return *this;
+    }
+
+    bool onHeap() const {
+        return static_cast<const void*>(pb) !=
+               static_cast<const void*>(buffer);
+    }
+
+    BitMap& bitmap() { return *pb; }
+    const BitMap& bitmap() const { return *pb; }
+
+    void test() const { pb->test(); }
+
+private:
+    void* allocate(std::size_t bytes) {
+        if (bytes <= kInlineBytes) {
+            capacity = kInlineBytes;
+            return buffer;
+        }
+        void* memory = heapAllocate(bytes);
+        capacity = bytes;
+        return memory;
+    }
+
+    // 堆上的位图直接接管指针，内联的位图复制过来。两种情况下 rhs 都变成 0 位
+    void steal(Widget& rhs) noexcept {
+        if (rhs.onHeap()) {
+            pb = rhs.pb;
+            capacity = rhs.capacity;
+            rhs.pb = BitMap::create(rhs.buffer, 0);
+            rhs.capacity = kInlineBytes;
+        } else {
+            pb = BitMap::copy(buffer, *rhs.pb);
+            capacity = kInlineBytes;
+            rhs.pb = BitMap::create(rhs.buffer, 0);
+        }
+    }
+
+    BitMap* pb;  // 指向 buffer 或堆内存
+    std::size_t capacity;
+    alignas(uint64_t) unsigned char buffer[kInlineBytes];
+};
+
+// 对照组：ex4 的写法，每次构造和赋值都在堆上分配
+class HeapWidget {
+public:
+    explicit HeapWidget(std::size_t bits = 0)
+        : pb(BitMap::create(heapAllocate(BitMap::bytesFor(bits)), bits)) {}
+
+    HeapWidget(const HeapWidget& rhs)
+        : pb(BitMap::copy(heapAllocate(rhs.pb->bytes()), *rhs.pb)) {}
+
+    ~HeapWidget() { heapFree(pb); }
+
+    HeapWidget& operator=(const HeapWidget& rhs) {
+        BitMap* pOrig = pb;  // 保存当前 pb 的副本
+        pb = BitMap::copy(heapAllocate(rhs.pb->bytes()), *rhs.pb);
+        heapFree(pOrig);  // 保证在分配成功后再删除原有 pb
+        return *this;
+    }
+
+    BitMap& bitmap() { return *pb; }
+    const BitMap& bitmap() const { return *pb; }
+
+private:
+    BitMap* pb;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// 构造、拷贝、赋值、销毁，返回每轮的纳秒数
+template <typename W>
+double churn(std::size_t bits, int rounds, uint64_t& allocsPerRound) {
+    uint64_t before = allocations;
+    std::size_t sink = 0;
+    W other(bits);
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        W w(bits);
+        w.bitmap().set(r % bits);
+        W copy(w);
+        other = copy;
+        sink += other.bitmap().count();
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start)
+                    .count() /
+                rounds;
+    allocsPerRound = (allocations - before) / rounds;
+    if (sink == 0) std::cout << "";
+    return ns;
+}
+
+int main() {
+    // 1. 内联与堆之间的转换
+    Widget small(100), large(1000);
+    small.bitmap().set(7);
+    large.bitmap().set(999);
+    std::cout << "small on heap: " << small.onHeap()
+              << ", large on heap: " << large.onHeap() << std::endl;
+    Widget w(small);
+    w = large;  // 内联 -> 堆
+    std::cout << "after w = large, on heap: " << w.onHeap() << ", ";
+    w.test();
+    w = small;  // 堆 -> 内联
+    std::cout << "after w = small, on heap: " << w.onHeap() << ", ";
+    w.test();
+    w = w;
+    Widget moved(std::move(large));
+    std::cout << "moved on heap: " << moved.onHeap() << ", source size "
+              << large.bitmap().size() << std::endl;
+    Widget movedInline(std::move(small));
+    std::cout << "moved inline on heap: " << movedInline.onHeap()
+              << ", source size " << small.bitmap().size() << std::endl;
+
+    // 2. 分配次数和耗时
+    const int rounds = 10000000;
+    std::size_t sizes[] = {256, 4096};
+    for (int i = 0; i < 2; ++i) {
+        uint64_t heapAllocs = 0, inlineAllocs = 0;
+        double heap = churn<HeapWidget>(sizes[i], rounds, heapAllocs);
+        double sbo = churn<Widget>(sizes[i], rounds, inlineAllocs);
+        std::cout << sizes[i] << " bits: heap " << heap << " ns ("
+                  << heapAllocs << " allocs), inline buffer " << sbo
+                  << " ns (" << inlineAllocs << " allocs) per round"
+                  << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// 用 32 位整数表示日期，代替 "2020-10-03" 这样的字符串。
+//
+// 编码为 year << 9 | month << 5 | day，整数的大小顺序就是日期的先后顺序，
+// 比较只需一条指令，拷贝也不会分配内存。
+// 解析和格式化用 SWAR（在一个 64 位寄存器里同时处理 8 个字节）完成。
+
+class Date {
+public:
+    Date() : packed(0) {}
+
+    // 非法的日期抛出 std::invalid_argument
+    explicit Date(const std::string& iso) : packed(0) {
+        if (!parse(iso.data(), iso.size(), *this)) {
+            throw std::invalid_argument("bad ISO-8601 date: " + iso);
+        }
+    }
+
+    static Date fromYmd(int y, int m, int d) {
+        if (!valid(y, m, d)) throw std::invalid_argument("bad date");
+        return Date(y << 9 | m << 5 | d);
+    }
+
+    // 解析 "YYYY-MM-DD"，成功时写入 out 并返回 true。热路径上不抛异常
+    static bool parse(const char* s, std::size_t len, Date& out) {
+        if (len != 10) return false;
+        uint64_t lo;
+        uint16_t hi;
+        std::memcpy(&lo, s, 8);  // "YYYY-MM-"
+        std::memcpy(&hi, s + 8, 2);  // "DD"
+
+        // 两个 '-' 分别在第 4、7 字节（小端），把它们换成 '0' 后统一检查数字
+        const uint64_t dashes = 0x2D00002D00000000ULL;
+        const uint64_t dashMask = 0xFF0000FF00000000ULL;
+        if ((lo & dashMask) != dashes) return false;
+        lo = (lo & ~dashMask) | (0x3030303030303030ULL & dashMask);
+        if (!allDigits(lo) || !allDigits(0x3030303030300000ULL | hi)) {
+            return false;
+        }
+        lo -= 0x3030303030303030ULL;
+        hi -= 0x3030;
+
+        // 年份：相邻两位合成 0-99，再合成 0-9999
+        uint32_t y = static_cast<uint32_t>(lo);
+        y = (y * 10 + (y >> 8)) & 0x00FF00FF;
+        y = (y * 100 + (y >> 16)) & 0x3FFF;
+        uint32_t m = (lo >> 40 & 0xFF) * 10 + (lo >> 48 & 0xFF);
+        uint32_t d = (hi & 0xFF) * 10 + (hi >> 8);
+        if (!valid(y, m, d)) return false;
+        out.packed = y << 9 | m << 5 | d;
+        return true;
+    }
+
+    // 写出 10 个字符 "YYYY-MM-DD"，不写结尾的 '\0'
+    void format(char* out) const {
+        uint32_t y = year();
+        // 四个 0-99 的数各占 16 位：年份前两位、后两位、月、日
+        uint64_t x = (y / 100) | static_cast<uint64_t>(y % 100) << 16 |
+                     static_cast<uint64_t>(month()) << 32 |
+                     static_cast<uint64_t>(day()) << 48;
+        // n < 100 时 n * 103 >> 10 == n / 10，乘积不会超出 16 位
+        uint64_t tens = (x * 103 >> 10) & 0x000F000F000F000FULL;
+        uint64_t ones = x - tens * 10;
+        uint64_t chars = tens | ones << 8 | 0x3030303030303030ULL;
+        char digits[8];
+        std::memcpy(digits, &chars, 8);
+        std::memcpy(out, digits, 4);
+        out[4] = '-';
+        std::memcpy(out + 5, digits + 4, 2);
+        out[7] = '-';
+        std::memcpy(out + 8, digits + 6, 2);
+    }
+
+    std::string toString() const {
+        char buf[10];
+        format(buf);
+        return std::string(buf, 10);
+    }
+
+    int year() const { return packed >> 9; }
+    int month() const { return packed >> 5 & 0xF; }
+    int day() const { return packed & 0x1F; }
+    uint32_t raw() const { return packed; }
+
+    friend bool operator==(Date a, Date b) { return a.packed == b.packed; }
+    friend bool operator!=(Date a, Date b) { return a.packed != b.packed; }
+    friend bool operator<(Date a, Date b) { return a.packed < b.packed; }
+    friend bool operator<=(Date a, Date b) { return a.packed <= b.packed; }
+
+private:
+    explicit Date(uint32_t packed_) : packed(packed_) {}
+
+    // 8 个字节是否都是 '0'-'9'
+    static bool allDigits(uint64_t v) {
+        return ((v & 0xF0F0F0F0F0F0F0F0ULL) |
+                (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >>
+                 4)) == 0x3333333333333333ULL;
+    }
+
+    static bool valid(uint32_t y, uint32_t m, uint32_t d) {
+        static const uint8_t days[] = {31, 28, 31, 30, 31, 30,
+                                       31, 31, 30, 31, 30, 31};
+        if (y > 9999 || m < 1 || m > 12 || d < 1) return false;
+        bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+        return d <= days[m - 1] + (m == 2 && leap ? 1u : 0u);
+    }
+
+    uint32_t packed;
+};
+
+class Customer {
+public:
+    Customer() {}
+    Customer(const std::string& name_, const std::string& date_)
+        : name(name_), date(date_) {}
+    Customer(const std::string& name_, Date date_)
+        : name(name_), date(date_) {}
+    Customer(const Customer& rhs);
+    Customer& operator=(const Customer& rhs);
+
+    const std::string& getName() const { return name; }
+    Date getDate() const { return date; }
+
+    void print() {
+        std::cout << "name: " << name << ", date: " << date.toString()
+                  << std::endl;
+    }
+
+private:
+    std::string name;
+    Date date;
+};
+
+// 与 ex3 相同，拷贝所有成员；date 只是 4 个字节
+Customer::Customer(const Customer& rhs) : name(rhs.name), date(rhs.date) {}
+
+Customer& Customer::operator=(const Customer& rhs) {
+    name = rhs.name;
+    date = rhs.date;
+    return *this;
+}
+
+// 按日期排序的索引，日期和行号分开存放，二分查找时只访问日期数组
+class DateIndex {
+public:
+    explicit DateIndex(const std::vector<Customer>& customers) {
+        std::vector<uint64_t> keyed(customers.size());
+        for (std::size_t i = 0; i < customers.size(); ++i) {
+            keyed[i] = static_cast<uint64_t>(customers[i].getDate().raw())
+                           << 32 |
+                       i;
+        }
+        std::sort(keyed.begin(), keyed.end());
+        dates.resize(keyed.size());
+        rows.resize(keyed.size());
+        for (std::size_t i = 0; i < keyed.size(); ++i) {
+            dates[i] = keyed[i] >> 32;
+            rows[i] = static_cast<uint32_t>(keyed[i]);
+        }
+    }
+
+    // 日期在 [from, to] 内的顾客在原集合中的下标，按日期排序
+    std::vector<uint32_t> range(Date from, Date to) const {
+        std::size_t first = lowerBound(from.raw());
+        std::size_t last = lowerBound(to.raw() + 1);
+        return std::vector<uint32_t>(rows.begin() + first,
+                                     rows.begin() + std::max(first, last));
+    }
+
+    std::size_t count(Date from, Date to) const {
+        std::size_t first = lowerBound(from.raw());
+        std::size_t last = lowerBound(to.raw() + 1);
+        return last > first ? last - first : 0;
+    }
+
+private:
+    std::size_t lowerBound(uint32_t key) const {
+        return std::lower_bound(dates.begin(), dates.end(), key) -
+               dates.begin();
+    }
+
+    std::vector<uint32_t> dates;
+    std::vector<uint32_t> rows;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+        .count();
+}
+
+// 参照实现
+bool scanfParse(const std::string& s, int& y, int& m, int& d) {
+    char tail;
+    return s.size() == 10 && s[4] == '-' && s[7] == '-' &&
+           std::sscanf(s.c_str(), "%4d-%2d-%2d%c", &y, &m, &d, &tail) == 3;
+}
+
+int main() {
+    // 1. 基本用法
+    Customer c1("A", "2020-10-03");
+    Customer c2("B", Date::fromYmd(2020, 10, 1));
+    c2 = c1;
+    c1.print();
+    c2.print();
+    const char* bad[] = {"2020-02-30", "2020-13-01", "2020/10/03", "20a0-10-03",
+                         "2020-10-3"};
+    for (std::size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        Date d;
+        std::cout << bad[i] << " -> "
+                  << (Date::parse(bad[i], std::strlen(bad[i]), d) ? "ok"
+                                                                  : "rejected")
+                  << std::endl;
+    }
+
+    // 2. 0000-9999 年中每隔 7 年取一年（其中有闰年、整百年和整四百年），
+    //    逐个核对每个月的 0-32 日，月份包括非法的 0 和 13，结果与 sscanf 比较
+    std::size_t checked = 0, mismatches = 0;
+    for (int y = 0; y <= 9999; y += 7) {
+        for (int m = 0; m <= 13; ++m) {
+            for (int d = 0; d <= 32; ++d) {
+                char s[40];  // 按 int 的最大宽度留足空间，避免截断警告
+                std::snprintf(s, sizeof(s), "%04d-%02d-%02d", y, m, d);
+                Date date;
+                bool ok = Date::parse(s, 10, date);
+                bool expected = true;
+                try {
+                    Date::fromYmd(y, m, d);
+                } catch (const std::invalid_argument&) {
+                    expected = false;
+                }
+                int ry, rm, rd;
+                if (ok != expected ||
+                    (ok && (date.toString() != s ||
+                            !scanfParse(s, ry, rm, rd) || date.year() != ry ||
+                            date.month() != rm || date.day() != rd))) {
+                    ++mismatches;
+                }
+                ++checked;
+            }
+        }
+    }
+    std::cout << "checked " << checked << " strings, " << mismatches
+              << " mismatches" << std::endl;
+
+    // 3. 解析、格式化和比较的吞吐量
+    const std::size_t n = 5000000;
+    std::vector<std::string> text(n);
+    std::vector<Date> parsed(n);
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    for (std::size_t i = 0; i < n; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        text[i] = Date::fromYmd(1970 + rng % 60, 1 + (rng >> 8) % 12,
+                                1 + (rng >> 16) % 28)
+                      .toString();
+    }
+
+    Clock::time_point start = Clock::now();
+    std::size_t ok = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        int y, m, d;
+        ok += scanfParse(text[i], y, m, d);
+    }
+    std::cout << "sscanf parse: " << elapsedNs(start) / n << " ns/date"
+              << std::endl;
+
+    start = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) {
+        ok += Date::parse(text[i].data(), text[i].size(), parsed[i]);
+    }
+    std::cout << "SWAR parse:   " << elapsedNs(start) / n << " ns/date"
+              << std::endl;
+
+    char out[10];
+    start = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) {
+        parsed[i].format(out);
+        ok += out[9];
+    }
+    std::cout << "SWAR format:  " << elapsedNs(start) / n << " ns/date"
+              << std::endl;
+
+    start = Clock::now();
+    std::size_t less = 0;
+    for (std::size_t i = 1; i < n; ++i) less += text[i - 1] < text[i];
+    std::cout << "string compare: " << elapsedNs(start) / n << " ns, ";
+    start = Clock::now();
+    for (std::size_t i = 1; i < n; ++i) less += parsed[i - 1] < parsed[i];
+    std::cout << "Date compare: " << elapsedNs(start) / n << " ns"
+              << std::endl;
+
+    // 4. 区间查询：有序索引与逐个比较字符串
+    std::vector<Customer> customers;
+    customers.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        customers.push_back(Customer("customer", parsed[i]));
+    }
+    start = Clock::now();
+    DateIndex index(customers);
+    std::cout << "index build: " << elapsedNs(start) / 1e6 << " ms"
+              << std::endl;
+
+    Date from = Date::fromYmd(2000, 1, 1), to = Date::fromYmd(2000, 12, 31);
+    const std::string fromText = "2000-01-01", toText = "2000-12-31";
+    start = Clock::now();
+    std::size_t scanned = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        scanned += fromText <= text[i] && text[i] <= toText;
+    }
+    double scanNs = elapsedNs(start);
+    const int queries = 100000;
+    std::size_t found = 0;
+    start = Clock::now();
+    for (int q = 0; q < queries; ++q) found += index.count(from, to);
+    double indexNs = elapsedNs(start) / queries;
+    std::cout << "range query: linear scan " << scanNs / 1e6 << " ms, index "
+              << indexNs << " ns, " << found / queries << " customers"
+              << (found / queries == scanned ? "" : " (MISMATCH)")
+              << std::endl;
+    std::vector<uint32_t> rows = index.range(from, from);
+    std::cout << rows.size() << " customers on " << from.toString()
+              << std::endl;
+    if (ok + less == 0) std::cout << "";
+
+    return 0;
+}
\ No newline at end of file
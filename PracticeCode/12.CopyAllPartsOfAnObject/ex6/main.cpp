@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// 平凡可拷贝的 Customer。
+//
+// ex3 的 Customer 有两个 std::string 成员和自定义的拷贝操作，vector 扩容、
+// 排序时只能逐个调用拷贝构造函数。这里把字符串换成定长的内联缓冲区，
+// 不再声明任何拷贝操作：编译器生成的版本自然会拷贝所有成员（包括基类部分），
+// 而且是平凡的，可以直接 memcpy，也可以用 realloc 整块搬走。
+
+// 定长字符串，最多 N - 1 个字符，最后一个字节存长度。
+// 多余的字节都是 0，所以比较时直接 memcmp 整个缓冲区就是字典序
+template <std::size_t N>
+class InlineString {
+    static_assert(N >= 2 && N <= 256, "length must fit in one byte");
+
+public:
+    InlineString() { std::memset(buf, 0, N); }
+
+    InlineString(const char* s, std::size_t len) {
+        if (len > N - 1) throw std::length_error("InlineString: too long");
+        std::memset(buf, 0, N);
+        std::memcpy(buf, s, len);
+        buf[N - 1] = static_cast<char>(len);
+    }
+
+    explicit InlineString(const std::string& s)
+        : InlineString(s.data(), s.size()) {}
+
+    std::size_t size() const { return static_cast<unsigned char>(buf[N - 1]); }
+    const char* data() const { return buf; }
+    std::string str() const { return std::string(buf, size()); }
+
+    friend bool operator<(const InlineString& a, const InlineString& b) {
+        return std::memcmp(a.buf, b.buf, N - 1) < 0;
+    }
+
+    friend bool operator==(const InlineString& a, const InlineString& b) {
+        return std::memcmp(a.buf, b.buf, N) == 0;
+    }
+
+private:
+    char buf[N];
+};
+
+class CustomerRecord {
+public:
+    CustomerRecord() {}
+    CustomerRecord(const std::string& name_, const std::string& date_)
+        : name(name_), date(date_) {}
+    CustomerRecord(const char* name_, std::size_t nameLen, const char* date_,
+                   std::size_t dateLen)
+        : name(name_, nameLen), date(date_, dateLen) {}
+    // 不声明拷贝构造函数和 copy assignment，由编译器生成
+
+    const InlineString<24>& getName() const { return name; }
+    const InlineString<11>& getDate() const { return date; }
+
+    void print() const {
+        std::cout << "name: " << name.str() << ", date: " << date.str()
+                  << std::endl;
+    }
+
+private:
+    InlineString<24> name;
+    InlineString<11> date;  // "YYYY-MM-DD"
+};
+
+class PriorityCustomerRecord : public CustomerRecord {
+public:
+    PriorityCustomerRecord() : priority(0) {}
+    PriorityCustomerRecord(const std::string& name_, const std::string& date_,
+                           int priority_)
+        : CustomerRecord(name_, date_), priority(priority_) {}
+    PriorityCustomerRecord(const char* name_, std::size_t nameLen,
+                           const char* date_, std::size_t dateLen,
+                           int priority_)
+        : CustomerRecord(name_, nameLen, date_, dateLen),
+          priority(priority_) {}
+
+    int getPriority() const { return priority; }
+
+    void printProfile() const {
+        print();
+        std::cout << "Priority: " << priority << std::endl;
+    }
+
+private:
+    int priority;
+};
+
+static_assert(std::is_trivially_copyable<PriorityCustomerRecord>::value,
+              "records must be copyable with memcpy");
+static_assert(sizeof(PriorityCustomerRecord) == 40, "unexpected padding");
+
+// 只接受平凡可拷贝类型的动态数组：扩容用 realloc，大块内存时
+// glibc 会用 mremap 直接移动页表，元素一个字节也不用拷贝
+template <typename T>
+class RelocatingVector {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "T must be trivially copyable");
+
+public:
+    RelocatingVector() : first(0), count(0), cap(0) {}
+    ~RelocatingVector() { std::free(first); }
+
+    void reserve(std::size_t n) {
+        if (n <= cap) return;
+        void* p = std::realloc(first, n * sizeof(T));
+        if (!p) throw std::bad_alloc();  // 失败时原来的内存保持不变
+        first = static_cast<T*>(p);
+        cap = n;
+    }
+
+    void push_back(const T& value) {
+        if (count == cap) reserve(cap ? cap * 2 : 16);
+        std::memcpy(static_cast<void*>(first + count), &value, sizeof(T));
+        ++count;
+    }
+
+    // 整块追加
+    void append(const T* values, std::size_t n) {
+        if (count + n > cap) reserve(std::max(count + n, cap * 2));
+        std::memcpy(static_cast<void*>(first + count), values, n * sizeof(T));
+        count += n;
+    }
+
+    T* begin() { return first; }
+    T* end() { return first + count; }
+    const T* data() const { return first; }
+    std::size_t size() const { return count; }
+    T& operator[](std::size_t i) { return first[i]; }
+
+private:
+    RelocatingVector(const RelocatingVector&);
+    RelocatingVector& operator=(const RelocatingVector&);
+
+    T* first;
+    std::size_t count;
+    std::size_t cap;
+};
+
+// 对照组：ex3 的 Customer，去掉了拷贝时的输出
+class Customer {
+public:
+    Customer() {}
+    Customer(const std::string& name_, const std::string& date_)
+        : name(name_), date(date_) {}
+    Customer(const Customer& rhs);
+    Customer& operator=(const Customer& rhs);
+
+    const std::string& getName() const { return name; }
+    const std::string& getDate() const { return date; }
+
+private:
+    std::string name;
+    std::string date;
+};
+
+Customer::Customer(const Customer& rhs) : name(rhs.name), date(rhs.date) {}
+
+Customer& Customer::operator=(const Customer& rhs) {
+    name = rhs.name;
+    date = rhs.date;
+    return *this;
+}
+
+class PriorityCustomer : public Customer {
+public:
+    PriorityCustomer(const std::string& name_, const std::string& date_,
+                     int priority_)
+        : Customer(name_, date_), priority(priority_) {}
+    PriorityCustomer(const PriorityCustomer& rhs)
+        : Customer(rhs),  // 调用基类 copy constructor
+          priority(rhs.priority) {}
+
+    PriorityCustomer& operator=(const PriorityCustomer& rhs) {
+        Customer::operator=(rhs);  // 调用基类 copy assignment
+        priority = rhs.priority;
+        return *this;
+    }
+
+    int getPriority() const { return priority; }
+
+private:
+    int priority;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+// 第 i 个顾客的名字和日期
+struct Generator {
+    Generator() : rng(0x9E3779B97F4A7C15ULL) {}
+
+    void next(std::size_t i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        nameLen = std::snprintf(name, sizeof(name), "customer-%zu", i);
+        dateLen = std::snprintf(date, sizeof(date), "%04d-%02d-%02d",
+                                static_cast<int>(1970 + rng % 60),
+                                static_cast<int>(1 + (rng >> 8) % 12),
+                                static_cast<int>(1 + (rng >> 16) % 28));
+        priority = static_cast<int>((rng >> 32) % 64);
+    }
+
+    uint64_t rng;
+    char name[24];
+    std::size_t nameLen;
+    char date[16];
+    std::size_t dateLen;
+    int priority;
+};
+
+template <typename C>
+bool byDateThenName(const C& a, const C& b) {
+    if (a.getDate() == b.getDate()) return a.getName() < b.getName();
+    return a.getDate() < b.getDate();
+}
+
+int main(int argc, char** argv) {
+    // 1. 编译器生成的拷贝操作拷贝了所有成员
+    PriorityCustomerRecord c1("A", "2020-10-03", 1);
+    PriorityCustomerRecord c2("B", "2020-10-01", 2);
+    c2 = c1;
+    c1.printProfile();
+    c2.printProfile();
+    try {
+        CustomerRecord tooLong("a name that does not fit inline", "2020-10-03");
+    } catch (const std::exception& e) {
+        std::cout << "exception caught: " << e.what() << std::endl;
+    }
+    std::cout << "sizeof(PriorityCustomer) = " << sizeof(PriorityCustomer)
+              << ", sizeof(PriorityCustomerRecord) = "
+              << sizeof(PriorityCustomerRecord) << std::endl;
+
+    // 2. 扩容、排序和整块拷贝，默认一千万个顾客
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], 0, 10) : 10000000;
+    std::cout << n << " customers (times in ms)" << std::endl;
+    Generator g;
+    Clock::time_point start = Clock::now();
+    int sink = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        g.next(i);
+        sink += g.priority;
+    }
+    std::cout << "generating names and dates alone: " << elapsedMs(start)
+              << " (included in grow)" << std::endl;
+    if (sink == -1) std::cout << "";
+
+    g = Generator();
+    {
+        std::vector<PriorityCustomer> v;
+        start = Clock::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            g.next(i);
+            v.push_back(PriorityCustomer(std::string(g.name, g.nameLen),
+                                         g.date, g.priority));
+        }
+        double grow = elapsedMs(start);
+        start = Clock::now();
+        std::sort(v.begin(), v.end(), byDateThenName<PriorityCustomer>);
+        double sort = elapsedMs(start);
+        start = Clock::now();
+        std::vector<PriorityCustomer> copy(v);
+        double transfer = elapsedMs(start);
+        std::cout << "std::string customers, std::vector:  grow " << grow
+                  << ", sort " << sort << ", copy " << transfer << std::endl;
+    }
+
+    g = Generator();
+    {
+        std::vector<PriorityCustomerRecord> v;
+        start = Clock::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            g.next(i);
+            v.push_back(PriorityCustomerRecord(g.name, g.nameLen, g.date,
+                                               g.dateLen, g.priority));
+        }
+        double grow = elapsedMs(start);
+        start = Clock::now();
+        std::sort(v.begin(), v.end(), byDateThenName<PriorityCustomerRecord>);
+        double sort = elapsedMs(start);
+        start = Clock::now();
+        std::vector<PriorityCustomerRecord> copy(v);
+        double transfer = elapsedMs(start);
+        std::cout << "inline records,        std::vector:  grow " << grow
+                  << ", sort " << sort << ", copy " << transfer << std::endl;
+    }
+
+    g = Generator();
+    {
+        RelocatingVector<PriorityCustomerRecord> v;
+        start = Clock::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            g.next(i);
+            v.push_back(PriorityCustomerRecord(g.name, g.nameLen, g.date,
+                                               g.dateLen, g.priority));
+        }
+        double grow = elapsedMs(start);
+        start = Clock::now();
+        std::sort(v.begin(), v.end(), byDateThenName<PriorityCustomerRecord>);
+        double sort = elapsedMs(start);
+        start = Clock::now();
+        RelocatingVector<PriorityCustomerRecord> copy;
+        copy.append(v.data(), v.size());
+        double transfer = elapsedMs(start);
+        std::cout << "inline records,   RelocatingVector:  grow " << grow
+                  << ", sort " << sort << ", copy " << transfer << std::endl;
+        v[0].printProfile();
+    }
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// createInvestment() 的对象池版本。
+//
+// - 每个线程有自己的空闲链表，分配和释放通常不加锁
+// - 线程缓存空了时从全局仓库取一批，超过 kMaxCached 时还回一批，
+//   一批 kBatch 个块。线程之间的不平衡（一个线程分配、另一个线程释放）
+//   就靠仓库调节
+// - createInvestment(pool) 返回带删除器的 unique_ptr，析构时把内存还给池
+// - 线程缓存是 thread_local 的，不区分池，所以池是单例，只能通过
+//   investmentPool() 取得
+// - 仓库的容量在切分 slab 时就预留好，释放路径上不会抛出异常
+
+class Investment {
+public:
+    Investment() : amount(0), openedDay(0) {}  // 去掉了输出，便于测量
+    ~Investment() {}
+
+    double amount;
+    int openedDay;
+};
+
+Investment* createInvestment() { return new Investment(); }
+
+class InvestmentPool {
+public:
+    static const std::size_t kBatch = 64;
+    static const std::size_t kMaxCached = 8 * kBatch;  // 线程缓存的上限
+    static const std::size_t kBlocksPerSlab = 16 * kBatch;
+
+    // 析构对象并把内存还给池
+    struct Deleter {
+        void operator()(Investment* p) const;
+    };
+
+    void* allocate() {
+        ThreadCache& c = cache();
+        if (!c.head) refill(c);
+        Block* b = c.head;
+        c.head = b->next;
+        --c.count;
+        return b;
+    }
+
+    void deallocate(void* p) {
+        ThreadCache& c = cache();
+        Block* b = static_cast<Block*>(p);
+        b->next = c.head;
+        c.head = b;
+        if (++c.count >= kMaxCached) flush(c, kBatch);
+    }
+
+    uint64_t slabCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return slabsAllocated;
+    }
+
+    uint64_t depotTransfers() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return transfers;
+    }
+
+private:
+    friend InvestmentPool& investmentPool();
+
+    InvestmentPool() : slabsAllocated(0), transfers(0) {
+        partial.head = 0;
+        partial.count = 0;
+    }
+
+    // 程序退出时析构，此前所有线程都已经不再使用池
+    ~InvestmentPool() {
+        for (std::size_t i = 0; i < slabs.size(); ++i) delete[] slabs[i];
+    }
+
+    union Block {
+        Block* next;
+        alignas(Investment) unsigned char storage[sizeof(Investment)];
+    };
+
+    struct Chain {
+        Block* head;
+        std::size_t count;
+    };
+
+    // 线程退出时把所有块还给池
+    struct ThreadCache {
+        ThreadCache() : head(0), count(0) {}
+        ~ThreadCache();
+
+        Block* head;
+        std::size_t count;
+    };
+
+    static ThreadCache& cache() {
+        static thread_local ThreadCache c;
+        return c;
+    }
+
+    void refill(ThreadCache& c) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (depot.empty()) carveSlab();
+        Chain chain = depot.back();
+        depot.pop_back();
+        ++transfers;
+        c.head = chain.head;
+        c.count = chain.count;
+    }
+
+    // 把本线程缓存的前 n 个块还给仓库。仓库里每条链都是整批，条数不会
+    // 超过 carveSlab 预留的容量，push_back 不会重新分配，也就不会抛出
+    void flush(ThreadCache& c, std::size_t n) {
+        Chain chain = {c.head, n};
+        Block* last = c.head;
+        for (std::size_t i = 1; i < n; ++i) last = last->next;
+        c.head = last->next;
+        c.count -= n;
+        last->next = 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        depot.push_back(chain);
+        ++transfers;
+    }
+
+    // 线程退出时调用：整批的还给仓库，不足一批的先攒在 partial 中，
+    // 凑满一批再放进仓库
+    void release(ThreadCache& c) {
+        while (c.count >= kBatch) flush(c, kBatch);
+        if (c.count == 0) return;
+        Block* last = c.head;
+        while (last->next) last = last->next;
+        std::lock_guard<std::mutex> lock(mutex);
+        last->next = partial.head;
+        partial.head = c.head;
+        partial.count += c.count;
+        c.head = 0;
+        c.count = 0;
+        if (partial.count >= kBatch) {
+            Chain chain = {partial.head, kBatch};
+            Block* end = partial.head;
+            for (std::size_t i = 1; i < kBatch; ++i) end = end->next;
+            partial.head = end->next;
+            partial.count -= kBatch;
+            end->next = 0;
+            depot.push_back(chain);
+            ++transfers;
+        }
+    }
+
+    // 调用者持有锁。new 失败时抛出 std::bad_alloc，仓库保持不变
+    void carveSlab() {
+        slabs.reserve(slabs.size() + 1);
+        depot.reserve((slabs.size() + 1) * (kBlocksPerSlab / kBatch));
+        Block* slab = new Block[kBlocksPerSlab];
+        slabs.push_back(slab);
+        ++slabsAllocated;
+        for (std::size_t i = 0; i < kBlocksPerSlab; i += kBatch) {
+            for (std::size_t j = 0; j + 1 < kBatch; ++j) {
+                slab[i + j].next = &slab[i + j + 1];
+            }
+            slab[i + kBatch - 1].next = 0;
+            Chain chain = {&slab[i], kBatch};
+            depot.push_back(chain);
+        }
+    }
+
+    InvestmentPool(const InvestmentPool&);
+    InvestmentPool& operator=(const InvestmentPool&);
+
+    std::mutex mutex;  // 保护下面所有成员
+    std::vector<Chain> depot;  // 每条链都是 kBatch 个块
+    Chain partial;             // 退出的线程留下的不足一批的块
+    std::vector<Block*> slabs;
+    uint64_t slabsAllocated;
+    uint64_t transfers;
+};
+
+// 整个程序唯一的池
+InvestmentPool& investmentPool() {
+    static InvestmentPool pool;
+    return pool;
+}
+
+InvestmentPool::ThreadCache::~ThreadCache() {
+    if (count != 0) investmentPool().release(*this);
+}
+
+void InvestmentPool::Deleter::operator()(Investment* p) const {
+    p->~Investment();
+    investmentPool().deallocate(p);
+}
+
+typedef std::unique_ptr<Investment, InvestmentPool::Deleter> PooledInvestment;
+
+// 使用池的重载。只有返回值不同不能构成重载，所以多一个池参数，
+// 实参总是 investmentPool()。构造函数抛出异常时内存还给池
+PooledInvestment createInvestment(InvestmentPool& pool) {
+    void* memory = pool.allocate();
+    try {
+        return PooledInvestment(new (memory) Investment());
+    } catch (...) {
+        pool.deallocate(memory);
+        throw;
+    }
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// 每个线程反复建立一个由 kPortfolio 个投资组成的短命组合再整体释放
+template <typename Make>
+double churn(int threads, std::size_t total, Make make) {
+    const std::size_t kPortfolio = 256;
+    const std::size_t rounds = total / threads / kPortfolio;
+    std::vector<std::thread> workers;
+    Clock::time_point start = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&, t] {
+            std::vector<decltype(make())> portfolio;
+            portfolio.reserve(kPortfolio);
+            double sum = 0;
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (std::size_t i = 0; i < kPortfolio; ++i) {
+                    portfolio.push_back(make());
+                    portfolio.back()->amount = static_cast<double>(i + t);
+                }
+                for (std::size_t i = 0; i < kPortfolio; i += 7) {
+                    sum += portfolio[i]->amount;
+                }
+                portfolio.clear();
+            }
+            if (sum < 0) std::cout << "";
+        }));
+    }
+    for (std::size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    return rounds * kPortfolio * threads / seconds;
+}
+
+std::unique_ptr<Investment> makeWithNew() {
+    return std::unique_ptr<Investment>(createInvestment());
+}
+
+PooledInvestment makeFromPool() { return createInvestment(investmentPool()); }
+
+int main() {
+    // 1. 用法：析构时内存回到池中，下一次分配会复用
+    void* first;
+    {
+        PooledInvestment pInv = createInvestment(investmentPool());
+        first = pInv.get();
+        std::cout << "pInv's address " << pInv.get() << std::endl;
+    }
+    PooledInvestment pInv2 = createInvestment(investmentPool());
+    std::cout << "pInv2's address: " << pInv2.get() << " (reused: "
+              << (pInv2.get() == first) << ")" << std::endl;
+
+    // 在一个线程分配、另一个线程释放
+    std::vector<PooledInvestment> handoff;
+    for (int i = 0; i < 1000; ++i) handoff.push_back(makeFromPool());
+    std::thread([&handoff] { handoff.clear(); }).join();
+    std::cout << "after cross-thread free: slabs "
+              << investmentPool().slabCount() << ", depot transfers "
+              << investmentPool().depotTransfers() << std::endl;
+
+    // 2. 分配、释放的吞吐量
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+              << std::endl;
+    const std::size_t total = 1 << 24;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        double heap = churn(threads, total, makeWithNew);
+        double pooled = churn(threads, total, makeFromPool);
+        std::cout << threads << " threads: new/delete " << heap / 1e6
+                  << " M objects/s, pool " << pooled / 1e6 << " M objects/s"
+                  << std::endl;
+    }
+    std::cout << "slabs " << investmentPool().slabCount()
+              << ", depot transfers " << investmentPool().depotTransfers()
+              << std::endl;
+
+    return 0;
+}
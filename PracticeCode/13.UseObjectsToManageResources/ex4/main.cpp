@@ -0,0 +1,405 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 侵入式引用计数：计数放在 Investment 对象内部，而不是 shared_ptr 那样
+// 另外分配一个控制块。
+//
+// - 计数策略可选：AtomicCount 可以跨线程共享，PlainCount 只在单线程中使用，
+//   拷贝时没有原子操作
+// - 弱引用按需开启：RefCounted 的第三个模板参数为 true 时对象多一个指针，
+//   第一次创建 WeakRef 时才分配旁路控制块，不用弱引用的类型没有任何开销
+
+struct AtomicCount {
+    typedef std::atomic<uint32_t> Counter;
+
+    static void increment(Counter& c) {
+        c.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 减到 0 时返回 true。acq_rel 保证其它线程之前的访问都发生在 delete 之前
+    static bool decrement(Counter& c) {
+        return c.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    // 计数为 0 说明对象正在销毁，不能再增加
+    static bool incrementIfNonZero(Counter& c) {
+        uint32_t n = c.load(std::memory_order_relaxed);
+        while (n != 0) {
+            if (c.compare_exchange_weak(n, n + 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static uint32_t load(const Counter& c) {
+        return c.load(std::memory_order_relaxed);
+    }
+
+    // 对象还没有共享给其它线程时使用，不需要原子的读改写
+    static void store(Counter& c, uint32_t n) {
+        c.store(n, std::memory_order_relaxed);
+    }
+
+    class Lock {
+    public:
+        Lock() { flag.clear(); }
+        void lock() {
+            while (flag.test_and_set(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+        void unlock() { flag.clear(std::memory_order_release); }
+
+    private:
+        std::atomic_flag flag;
+    };
+};
+
+struct PlainCount {
+    typedef uint32_t Counter;
+
+    static void increment(Counter& c) { ++c; }
+    static bool decrement(Counter& c) { return --c == 0; }
+    static bool incrementIfNonZero(Counter& c) { return c != 0 && ++c; }
+    static uint32_t load(const Counter& c) { return c; }
+    static void store(Counter& c, uint32_t n) { c = n; }
+
+    struct Lock {
+        void lock() {}
+        void unlock() {}
+    };
+};
+
+// 弱引用的旁路控制块。对象本身持有一个引用，每个 WeakRef 各持有一个
+template <typename T, typename Policy>
+struct WeakBlock {
+    explicit WeakBlock(T* object_) : refs(1), object(object_) {}
+
+    void addRef() { Policy::increment(refs); }
+    void release() {
+        if (Policy::decrement(refs)) delete this;
+    }
+
+    typename Policy::Counter refs;
+    typename Policy::Lock lock;  // 保护 object
+    T* object;                   // 对象销毁后为空
+};
+
+// 不需要弱引用时这个基类是空的
+template <typename T, typename Policy, bool Weak>
+class WeakSlot {
+protected:
+    void detachWeak() const {}
+};
+
+template <typename T, typename Policy>
+class WeakSlot<T, Policy, true> {
+public:
+    typedef WeakBlock<T, Policy> Block;
+
+    // 第一次调用时创建控制块，多个线程同时调用时只有一个会成功安装
+    Block* weakBlock(T* self) const {
+        Block* b = block.load(std::memory_order_acquire);
+        if (b) return b;
+        Block* fresh = new Block(self);
+        if (block.compare_exchange_strong(b, fresh,
+                                          std::memory_order_acq_rel)) {
+            return fresh;
+        }
+        delete fresh;
+        return b;
+    }
+
+protected:
+    WeakSlot() : block(0) {}
+    WeakSlot(const WeakSlot&) : block(0) {}
+    WeakSlot& operator=(const WeakSlot&) { return *this; }
+
+    // 计数已经为 0：在锁内清空 object，正在 lock() 的 WeakRef 要么已经
+    // 拿到了引用（那样计数就不会是 0），要么之后看到空指针
+    void detachWeak() const {
+        Block* b = block.load(std::memory_order_acquire);
+        if (!b) return;
+        b->lock.lock();
+        b->object = 0;
+        b->lock.unlock();
+        b->release();
+    }
+
+private:
+    mutable std::atomic<Block*> block;
+};
+
+template <typename T, typename Policy, bool Weak = false>
+class RefCounted : public WeakSlot<T, Policy, Weak> {
+public:
+    typedef Policy CountPolicy;
+
+    void addRef() const { Policy::increment(refs); }
+
+    void release() const {
+        if (Policy::decrement(refs)) {
+            T* self = const_cast<T*>(static_cast<const T*>(this));
+            this->detachWeak();
+            delete self;
+        }
+    }
+
+    uint32_t useCount() const { return Policy::load(refs); }
+
+    // 只给 WeakRef::lock() 使用
+    bool tryAddRef() const { return Policy::incrementIfNonZero(refs); }
+
+    // 只给 makeRef() 使用：新对象的第一个引用
+    void initRef() const { Policy::store(refs, 1); }
+
+protected:
+    RefCounted() : refs(0) {}
+    // 拷贝对象不拷贝计数
+    RefCounted(const RefCounted& rhs)
+        : WeakSlot<T, Policy, Weak>(rhs), refs(0) {}
+    RefCounted& operator=(const RefCounted&) { return *this; }
+    ~RefCounted() {}
+
+private:
+    mutable typename Policy::Counter refs;
+};
+
+template <typename T>
+class Ref {
+public:
+    Ref() : p(0) {}
+    explicit Ref(T* p_) : p(p_) {
+        if (p) p->addRef();
+    }
+    Ref(const Ref& rhs) : p(rhs.p) {
+        if (p) p->addRef();
+    }
+    Ref(Ref&& rhs) noexcept : p(rhs.p) { rhs.p = 0; }
+
+    ~Ref() {
+        if (p) p->release();
+    }
+
+    // 拷贝后交换，自我赋值也安全；指向同一个对象时计数不变
+    Ref& operator=(const Ref& rhs) {
+        if (p != rhs.p) Ref(rhs).swap(*this);
+        return *this;
+    }
+
+    Ref& operator=(Ref&& rhs) noexcept {
+        Ref(std::move(rhs)).swap(*this);
+        return *this;
+    }
+
+    // 接管一个已经计过数的指针，不再增加计数
+    static Ref adopt(T* p) {
+        Ref r;
+        r.p = p;
+        return r;
+    }
+
+    void swap(Ref& rhs) noexcept { std::swap(p, rhs.p); }
+    void reset() { Ref().swap(*this); }
+
+    T* get() const { return p; }
+    T* operator->() const { return p; }
+    T& operator*() const { return *p; }
+    explicit operator bool() const { return p != 0; }
+
+private:
+    T* p;
+};
+
+template <typename T>
+class WeakRef {
+public:
+    typedef typename T::Block Block;
+
+    WeakRef() : b(0) {}
+    explicit WeakRef(const Ref<T>& r) : b(r ? r->weakBlock(r.get()) : 0) {
+        if (b) b->addRef();
+    }
+    WeakRef(const WeakRef& rhs) : b(rhs.b) {
+        if (b) b->addRef();
+    }
+    ~WeakRef() {
+        if (b) b->release();
+    }
+
+    WeakRef& operator=(const WeakRef& rhs) {
+        Block* orig = b;
+        b = rhs.b;
+        if (b) b->addRef();
+        if (orig) orig->release();
+        return *this;
+    }
+
+    // 对象已经销毁时返回空的 Ref
+    Ref<T> lock() const {
+        if (!b) return Ref<T>();
+        b->lock.lock();
+        T* p = b->object && b->object->tryAddRef() ? b->object : 0;
+        b->lock.unlock();
+        return Ref<T>::adopt(p);
+    }
+
+    bool expired() const { return !lock(); }
+
+private:
+    Block* b;
+};
+
+template <typename T>
+Ref<T> makeRef() {
+    T* p = new T();
+    p->initRef();
+    return Ref<T>::adopt(p);
+}
+
+class Investment {
+public:
+    Investment() : amount(0), openedDay(0) {}  // 去掉了输出，便于测量
+    ~Investment() {}
+
+    double amount;
+    int openedDay;
+};
+
+// 引用计数放在 Investment 对象里
+template <typename Policy, bool Weak = false>
+class CountedInvestment
+    : public Investment,
+      public RefCounted<CountedInvestment<Policy, Weak>, Policy, Weak> {};
+
+typedef CountedInvestment<AtomicCount> SharedInvestment;
+typedef CountedInvestment<PlainCount> LocalInvestment;  // 只在单线程中使用
+typedef CountedInvestment<AtomicCount, true> WeakableInvestment;
+
+// 条款 13 的工厂函数，返回侵入式句柄
+Ref<SharedInvestment> createInvestment() { return makeRef<SharedInvestment>(); }
+
+typedef std::chrono::steady_clock Clock;
+
+// 按值传递，不让编译器内联后把计数操作消掉
+template <typename H>
+__attribute__((noinline)) double consume(H h) {
+    return h->amount;
+}
+
+struct Result {
+    double create, copy, pass;
+};
+
+// create：创建后销毁；copy：赋值到一个句柄数组里（新值加一、旧值减一）；
+// pass：按值传给函数
+template <typename H, typename Make>
+Result measure(Make make, int n) {
+    Result r;
+    double sink = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < n; ++i) {
+        H h = make();
+        h->amount = i;
+        sink += h->amount;
+    }
+    r.create = std::chrono::duration<double, std::nano>(Clock::now() - start)
+                   .count() /
+               n;
+
+    // 每一轮都换成另一个对象，否则赋值同一个对象时 shared_ptr 什么都不做
+    H h = make(), other = make();
+    std::vector<H> slots(1024);
+    start = Clock::now();
+    for (int i = 0; i < n; ++i) {
+        slots[i & 1023] = i >> 10 & 1 ? other : h;
+        sink += slots[(i + 512) & 1023] ? 1 : 0;
+    }
+    r.copy = std::chrono::duration<double, std::nano>(Clock::now() - start)
+                 .count() /
+             n;
+
+    start = Clock::now();
+    for (int i = 0; i < n; ++i) sink += consume<H>(h);
+    r.pass = std::chrono::duration<double, std::nano>(Clock::now() - start)
+                 .count() /
+             n;
+    if (sink < 0) std::cout << "";
+    return r;
+}
+
+template <typename H, typename Make>
+void report(const char* label, Make make) {
+    const int n = 10000000;
+    Result r = measure<H>(make, n);
+    std::cout << label << "create+destroy " << r.create << " ns, copy "
+              << r.copy << " ns, pass by value " << r.pass << " ns, handle "
+              << sizeof(H) << " bytes" << std::endl;
+}
+
+int main() {
+    // 1. 用法
+    {
+        Ref<SharedInvestment> pInv = createInvestment();
+        {
+            Ref<SharedInvestment> pInv2 = pInv;
+            std::cout << "pInv's address " << pInv.get() << ", use count "
+                      << pInv->useCount() << std::endl;
+        }
+        std::cout << "use count " << pInv->useCount() << std::endl;
+        // 计数在对象里，可以从裸指针重新得到共享所有权
+        Investment* raw = pInv.get();
+        Ref<SharedInvestment> again(static_cast<SharedInvestment*>(raw));
+        std::cout << "use count after rebuilding from raw pointer "
+                  << pInv->useCount() << std::endl;
+    }
+
+    WeakRef<WeakableInvestment> weak;
+    {
+        Ref<WeakableInvestment> strong = makeRef<WeakableInvestment>();
+        weak = WeakRef<WeakableInvestment>(strong);
+        std::cout << "weak expired while strong alive: " << weak.expired()
+                  << std::endl;
+    }
+    std::cout << "weak expired after strong released: " << weak.expired()
+              << std::endl;
+
+    // 多个线程同时释放强引用和提升弱引用
+    for (int round = 0; round < 1000; ++round) {
+        Ref<WeakableInvestment> strong = makeRef<WeakableInvestment>();
+        WeakRef<WeakableInvestment> w(strong);
+        std::thread t([w] {
+            Ref<WeakableInvestment> r = w.lock();
+            if (r) r->amount += 1;
+        });
+        strong.reset();
+        t.join();
+    }
+
+    // 2. 与 shared_ptr 比较
+    std::cout << "sizeof(Investment) = " << sizeof(Investment)
+              << ", with count = " << sizeof(SharedInvestment)
+              << ", with count and weak slot = " << sizeof(WeakableInvestment)
+              << std::endl;
+    report<std::shared_ptr<Investment> >(
+        "shared_ptr(new):     ",
+        [] { return std::shared_ptr<Investment>(new Investment()); });
+    report<std::shared_ptr<Investment> >(
+        "make_shared:         ",
+        [] { return std::make_shared<Investment>(); });
+    report<Ref<SharedInvestment> >("Ref, atomic count:   ",
+                                   makeRef<SharedInvestment>);
+    report<Ref<LocalInvestment> >("Ref, plain count:    ",
+                                  makeRef<LocalInvestment>);
+    report<Ref<WeakableInvestment> >("Ref, atomic + weak:  ",
+                                     makeRef<WeakableInvestment>);
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// RCU 风格的快照：写者发布一个新的不可变版本，读者缓存自己看到的版本。
+//
+// 用 shared_ptr 发布时，每个读者拷贝一次都要对同一个控制块做原子加减，
+// 所有核心都在争同一个缓存行。这里读者只读共享的版本号：
+// - 版本号没变，直接使用缓存的版本，不写任何共享内存
+// - 版本号变了才刷新，并在自己的槽里登记正在使用的版本号
+// 写者只释放比所有读者登记的版本号都旧的版本，所以旧版本在最后一个
+// 读者前进之后才会被回收。
+
+template <typename T>
+class Snapshot {
+    struct Version {
+        Version(const T& value_, uint64_t generation_)
+            : value(value_), generation(generation_) {}
+
+        const T value;
+        const uint64_t generation;
+    };
+
+    // 每个读者一个槽，各占一个缓存行
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> held;  // 该读者可能还在用的最旧版本号
+        std::atomic<bool> used;
+    };
+
+    static const uint64_t kNone = ~0ULL;
+
+public:
+    static const int kMaxReaders = 256;
+
+    explicit Snapshot(const T& initial)
+        : current(new Version(initial, 1)), generation(1), freedCount(0) {
+        for (int i = 0; i < kMaxReaders; ++i) {
+            slots[i].held.store(kNone);
+            slots[i].used.store(false);
+        }
+    }
+
+    // 调用者保证此时已经没有读者
+    ~Snapshot() {
+        for (std::size_t i = 0; i < retired.size(); ++i) delete retired[i];
+        delete current.load();
+    }
+
+    // 发布新版本。复制 value 抛出异常时什么都没有改变
+    void publish(const T& value) {
+        std::lock_guard<std::mutex> lock(writer);
+        uint64_t next = generation.load(std::memory_order_relaxed) + 1;
+        // 先预留，new 之后 push_back 不会再抛出，v 不会泄漏
+        retired.reserve(retired.size() + 1);
+        Version* v = new Version(value, next);
+        retired.push_back(current.exchange(v, std::memory_order_seq_cst));
+        generation.store(next, std::memory_order_seq_cst);
+        collect();
+    }
+
+    // 每个线程一个，持有该线程缓存的版本
+    class Reader {
+    public:
+        explicit Reader(Snapshot& snapshot_)
+            : snapshot(snapshot_), slot(snapshot_.acquireSlot()), cached(0) {
+            refresh();
+        }
+
+        ~Reader() {
+            slot->held.store(kNone, std::memory_order_release);
+            slot->used.store(false, std::memory_order_release);
+        }
+
+        // 返回的引用在下一次调用 get() 之前有效
+        const T& get() {
+            if (snapshot.generation.load(std::memory_order_acquire) !=
+                cached->generation) {
+                refresh();
+            }
+            return cached->value;
+        }
+
+    private:
+        Reader(const Reader&);
+        Reader& operator=(const Reader&);
+
+        // 先登记版本号再读指针：读到的版本不会比登记的旧，写者不会释放它
+        void refresh() {
+            uint64_t g = snapshot.generation.load(std::memory_order_seq_cst);
+            slot->held.store(g, std::memory_order_seq_cst);
+            cached = snapshot.current.load(std::memory_order_seq_cst);
+            snapshot.tryCollect();
+        }
+
+        Snapshot& snapshot;
+        Slot* slot;
+        const Version* cached;
+    };
+
+    uint64_t freedVersions() {
+        std::lock_guard<std::mutex> lock(writer);
+        return freedCount;
+    }
+
+private:
+    Slot* acquireSlot() {
+        for (int i = 0; i < kMaxReaders; ++i) {
+            bool expected = false;
+            if (!slots[i].used.load(std::memory_order_relaxed) &&
+                slots[i].used.compare_exchange_strong(expected, true)) {
+                return &slots[i];
+            }
+        }
+        throw std::runtime_error("Snapshot: too many readers");
+    }
+
+    // 读者刷新后顺便回收，拿不到锁就算了，读者从不等待
+    void tryCollect() {
+        std::unique_lock<std::mutex> lock(writer, std::try_to_lock);
+        if (lock.owns_lock() && !retired.empty()) collect();
+    }
+
+    // 调用者持有 writer
+    void collect() {
+        uint64_t oldest = kNone;
+        for (int i = 0; i < kMaxReaders; ++i) {
+            uint64_t h = slots[i].held.load(std::memory_order_seq_cst);
+            if (h < oldest) oldest = h;
+        }
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < retired.size(); ++i) {
+            if (retired[i]->generation < oldest) {
+                delete retired[i];
+                ++freedCount;
+            } else {
+                retired[kept++] = retired[i];
+            }
+        }
+        retired.resize(kept);
+    }
+
+    Snapshot(const Snapshot&);
+    Snapshot& operator=(const Snapshot&);
+
+    Slot slots[kMaxReaders];
+    std::atomic<Version*> current;
+    std::atomic<uint64_t> generation;  // 读者的快速路径只读这一个共享变量
+    std::mutex writer;  // 保护 retired 和 freedCount
+    std::vector<Version*> retired;
+    uint64_t freedCount;
+};
+
+class Investment {
+public:
+    Investment(double amount_, int openedDay_)
+        : amount(amount_), openedDay(openedDay_) {}
+
+    double amount;
+    int openedDay;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// readers 个读者不停地读，一个写者每隔 100 微秒发布一个新版本
+template <typename Read, typename Write>
+double readsPerSecond(int readers, Read read, Write write) {
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.push_back(std::thread([&] {
+            uint64_t n = read(stop);
+            reads.fetch_add(n);
+        }));
+    }
+    std::thread writer([&] {
+        for (int day = 1; !stop.load(std::memory_order_relaxed); ++day) {
+            write(day);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    Clock::time_point start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    stop.store(true);
+    for (std::size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    writer.join();
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    return reads.load() / seconds;
+}
+
+int main() {
+    // 1. 读者在下一次 get() 时看到新版本
+    Snapshot<Investment> snapshot(Investment(100, 1));
+    {
+        Snapshot<Investment>::Reader reader(snapshot);
+        std::cout << "day " << reader.get().openedDay << std::endl;
+        snapshot.publish(Investment(200, 2));
+        snapshot.publish(Investment(300, 3));
+        std::cout << "freed while reader holds day 1: "
+                  << snapshot.freedVersions() << std::endl;
+        std::cout << "day " << reader.get().openedDay << std::endl;
+        snapshot.publish(Investment(400, 4));
+        std::cout << "freed after reader advanced: "
+                  << snapshot.freedVersions() << std::endl;
+    }
+
+    // 2. 与 shared_ptr 的原子读写比较
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+              << std::endl;
+    for (int readers = 1; readers <= 64; readers *= 2) {
+        Snapshot<Investment> rcu(Investment(0, 0));
+        double rcuReads = readsPerSecond(
+            readers,
+            [&rcu](std::atomic<bool>& stop) {
+                Snapshot<Investment>::Reader reader(rcu);
+                uint64_t n = 0;
+                double sum = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    sum += reader.get().amount;
+                    ++n;
+                }
+                return n + (sum < 0);
+            },
+            [&rcu](int day) { rcu.publish(Investment(day, day)); });
+
+        std::shared_ptr<const Investment> shared =
+            std::make_shared<const Investment>(0, 0);
+        double sharedReads = readsPerSecond(
+            readers,
+            [&shared](std::atomic<bool>& stop) {
+                uint64_t n = 0;
+                double sum = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    std::shared_ptr<const Investment> p =
+                        std::atomic_load(&shared);
+                    sum += p->amount;
+                    ++n;
+                }
+                return n + (sum < 0);
+            },
+            [&shared](int day) {
+                std::atomic_store(&shared,
+                                  std::make_shared<const Investment>(day, day));
+            });
+
+        std::cout << readers << " readers: snapshot " << rcuReads / 1e6
+                  << " M reads/s, shared_ptr " << sharedReads / 1e6
+                  << " M reads/s, versions freed while running "
+                  << rcu.freedVersions()
+                  << std::endl;
+    }
+
+    return 0;
+}
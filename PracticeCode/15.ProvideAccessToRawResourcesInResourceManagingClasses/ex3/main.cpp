@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// 按列存放的 Portfolio，批量计算持有天数、分组和汇总。
+//
+// daysHeld(Investment*) 每次只处理一个散落在堆上的对象，每个对象都可能
+// 缓存未命中。Portfolio 把各个属性分别存成连续的数组：
+// - 批量内核只顺序读需要的列，用 target_clones 生成 AVX2 和通用两个版本，
+//   运行时自动选择。循环用 omp simd 归约，只需要 -fopenmp-simd，
+//   不依赖 OpenMP 运行库
+// - 按行切块在多个线程上并行，每块的部分结果按块的顺序合并，线程数不影响结果
+// - 仍然接受 Investment* 和 shared_ptr::get()，作为兼容接口
+
+const int32_t kToday = 20000;  // 以天为单位的“今天”，固定下来便于复现
+
+class Investment {
+public:
+    Investment(int openedDay_, int sector_, double amount_)
+        : openedDay(openedDay_), sector(sector_), amount(amount_) {}
+
+    int openedDay;
+    int sector;  // 行业编号 0-255
+    double amount;
+};
+
+// 返回投资天数
+int daysHeld(Investment* pi) { return kToday - pi->openedDay; }
+
+struct Totals {
+    Totals() : count(0), amount(0), weightedDays(0), maxDays(INT32_MIN) {}
+
+    void merge(const Totals& rhs) {
+        count += rhs.count;
+        amount += rhs.amount;
+        weightedDays += rhs.weightedDays;
+        maxDays = std::max(maxDays, rhs.maxDays);
+    }
+
+    // 按金额加权的平均持有天数
+    double averageDays() const { return amount ? weightedDays / amount : 0; }
+
+    std::size_t count;
+    double amount;
+    double weightedDays;  // sum(amount * daysHeld)
+    int32_t maxDays;
+};
+
+// 批量内核：只接受裸数组，便于编译器向量化
+
+// ThreadSanitizer 不支持 ifunc，用 -DPORTFOLIO_KERNEL= 关掉多版本
+#ifndef PORTFOLIO_KERNEL
+#define PORTFOLIO_KERNEL __attribute__((target_clones("avx2", "default")))
+#endif
+
+PORTFOLIO_KERNEL
+void daysHeldKernel(const int32_t* opened, std::size_t n, int32_t today,
+                    int32_t* out) {
+#pragma omp simd
+    for (std::size_t i = 0; i < n; ++i) out[i] = today - opened[i];
+}
+
+PORTFOLIO_KERNEL
+Totals totalsKernel(const int32_t* opened, const double* amount,
+                    std::size_t n, int32_t today) {
+    double sum = 0, weighted = 0;
+    int32_t maxDays = INT32_MIN;
+#pragma omp simd reduction(+ : sum, weighted) reduction(max : maxDays)
+    for (std::size_t i = 0; i < n; ++i) {
+        int32_t days = today - opened[i];
+        sum += amount[i];
+        weighted += amount[i] * days;
+        maxDays = std::max(maxDays, days);
+    }
+    Totals t;
+    t.count = n;
+    t.amount = sum;
+    t.weightedDays = weighted;
+    t.maxDays = maxDays;
+    return t;
+}
+
+// 分组需要按行业散射，先按块向量化地算出持有天数，再逐个累加到组里
+PORTFOLIO_KERNEL
+void groupKernel(const uint8_t* sector, const int32_t* opened,
+                 const double* amount, std::size_t n, int32_t today,
+                 Totals* groups) {
+    const std::size_t kBlock = 1024;
+    int32_t days[kBlock];
+    for (std::size_t first = 0; first < n; first += kBlock) {
+        std::size_t m = std::min(kBlock, n - first);
+#pragma omp simd
+        for (std::size_t i = 0; i < m; ++i) {
+            days[i] = today - opened[first + i];
+        }
+        for (std::size_t i = 0; i < m; ++i) {
+            Totals& g = groups[sector[first + i]];
+            ++g.count;
+            g.amount += amount[first + i];
+            g.weightedDays += amount[first + i] * days[i];
+            g.maxDays = std::max(g.maxDays, days[i]);
+        }
+    }
+}
+
+// 把 [0, n) 按 kChunk 切块，threads 个线程（包括调用者）轮流领取。
+// fn(chunk, begin, end) 的结果由调用者按块编号存放，和线程数无关
+template <typename Fn>
+void parallelChunks(std::size_t n, int threads, Fn fn) {
+    const std::size_t kChunk = 1 << 20;
+    std::size_t chunks = (n + kChunk - 1) / kChunk;
+    auto work = [&](int t) {
+        for (std::size_t c = t; c < chunks; c += threads) {
+            fn(c, c * kChunk, std::min(n, (c + 1) * kChunk));
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.push_back(std::thread(work, t));
+    work(0);
+    for (std::size_t t = 0; t < workers.size(); ++t) workers[t].join();
+}
+
+inline std::size_t chunkCount(std::size_t n) {
+    return (n + (1 << 20) - 1) >> 20;
+}
+
+class Portfolio {
+public:
+    static const int kSectors = 256;
+
+    void reserve(std::size_t n) {
+        opened.reserve(n);
+        sectors.reserve(n);
+        amounts.reserve(n);
+    }
+
+    void add(const Investment& inv) {
+        if (inv.sector < 0 || inv.sector >= kSectors) {
+            throw std::out_of_range("sector must be in [0, 255]");
+        }
+        opened.push_back(inv.openedDay);
+        sectors.push_back(static_cast<uint8_t>(inv.sector));
+        amounts.push_back(inv.amount);
+    }
+
+    // 兼容接口：Investment*、shared_ptr::get() 得到的裸指针
+    void add(Investment* pi) { add(*pi); }
+
+    // 元素可以是 Investment*、shared_ptr<Investment> 等能解引用的指针
+    template <typename It>
+    void addAll(It first, It last) {
+        for (; first != last; ++first) add(&**first);
+    }
+
+    std::size_t size() const { return opened.size(); }
+
+    std::vector<int32_t> daysHeld(int32_t today, int threads) const {
+        std::vector<int32_t> out(size());
+        parallelChunks(size(), threads, [&](std::size_t, std::size_t b,
+                                            std::size_t e) {
+            daysHeldKernel(&opened[b], e - b, today, &out[b]);
+        });
+        return out;
+    }
+
+    Totals totals(int32_t today, int threads) const {
+        std::vector<Totals> partial(chunkCount(size()));
+        parallelChunks(size(), threads, [&](std::size_t c, std::size_t b,
+                                            std::size_t e) {
+            partial[c] = totalsKernel(&opened[b], &amounts[b], e - b, today);
+        });
+        Totals t;
+        for (std::size_t c = 0; c < partial.size(); ++c) t.merge(partial[c]);
+        return t;
+    }
+
+    // 按行业分组，返回 kSectors 个结果
+    std::vector<Totals> bySector(int32_t today, int threads) const {
+        std::size_t chunks = chunkCount(size());
+        std::vector<Totals> partial(chunks * kSectors);
+        parallelChunks(size(), threads, [&](std::size_t c, std::size_t b,
+                                            std::size_t e) {
+            groupKernel(&sectors[b], &opened[b], &amounts[b], e - b, today,
+                        &partial[c * kSectors]);
+        });
+        std::vector<Totals> groups(kSectors);
+        for (std::size_t c = 0; c < chunks; ++c) {
+            for (int s = 0; s < kSectors; ++s) {
+                groups[s].merge(partial[c * kSectors + s]);
+            }
+        }
+        return groups;
+    }
+
+private:
+    std::vector<int32_t> opened;
+    std::vector<uint8_t> sectors;
+    std::vector<double> amounts;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+bool nearlyEqual(double a, double b) {
+    return std::fabs(a - b) <= 1e-9 * std::max(std::fabs(a), std::fabs(b));
+}
+
+int main(int argc, char** argv) {
+    // 1. 兼容接口
+    std::shared_ptr<Investment> pInv(new Investment(kToday - 30, 3, 1000));
+    int days = daysHeld(pInv.get());
+    Portfolio small;
+    small.add(pInv.get());
+    std::vector<std::shared_ptr<Investment> > owned(1, pInv);
+    small.addAll(owned.begin(), owned.end());
+    std::cout << "daysHeld: " << days
+              << ", batch: " << small.daysHeld(kToday, 1)[1] << std::endl;
+
+    // 2. 散落在堆上的投资，默认两千万个
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], 0, 10) : 20000000;
+    std::vector<Investment*> investments(n);
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    for (std::size_t i = 0; i < n; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        investments[i] = new Investment(kToday - static_cast<int>(rng % 3650),
+                                        static_cast<int>((rng >> 16) % 64),
+                                        static_cast<double>(rng >> 40) / 100);
+    }
+    for (std::size_t i = n; i > 1; --i) {  // 打乱访问顺序
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        std::swap(investments[i - 1], investments[rng % i]);
+    }
+    std::cout << n << " investments (times in ms)" << std::endl;
+
+    Clock::time_point start = Clock::now();
+    Totals scalar;
+    std::vector<Totals> scalarGroups(Portfolio::kSectors);
+    for (std::size_t i = 0; i < n; ++i) {
+        Investment* p = investments[i];
+        int d = daysHeld(p);
+        Totals one;
+        one.count = 1;
+        one.amount = p->amount;
+        one.weightedDays = p->amount * d;
+        one.maxDays = d;
+        scalar.merge(one);
+        scalarGroups[p->sector].merge(one);
+    }
+    std::cout << "per-pointer daysHeld + aggregates: " << elapsedMs(start)
+              << std::endl;
+
+    start = Clock::now();
+    Portfolio portfolio;
+    portfolio.reserve(n);
+    portfolio.addAll(investments.begin(), investments.end());
+    std::cout << "build columns from pointers:       " << elapsedMs(start)
+              << std::endl;
+
+    int maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        start = Clock::now();
+        std::vector<int32_t> held = portfolio.daysHeld(kToday, threads);
+        double tDays = elapsedMs(start);
+        start = Clock::now();
+        Totals t = portfolio.totals(kToday, threads);
+        double tTotals = elapsedMs(start);
+        start = Clock::now();
+        std::vector<Totals> groups = portfolio.bySector(kToday, threads);
+        double tGroups = elapsedMs(start);
+
+        bool ok = t.count == scalar.count && t.maxDays == scalar.maxDays &&
+                  nearlyEqual(t.amount, scalar.amount) &&
+                  nearlyEqual(t.weightedDays, scalar.weightedDays);
+        for (std::size_t i = 0; i < n; i += 9973) {
+            ok = ok && held[i] == daysHeld(investments[i]);
+        }
+        for (int s = 0; s < Portfolio::kSectors; ++s) {
+            const Totals& g = groups[s];
+            ok = ok && g.count == scalarGroups[s].count &&
+                 nearlyEqual(g.weightedDays, scalarGroups[s].weightedDays);
+        }
+        std::cout << threads << " threads columnar: daysHeld " << tDays
+                  << ", totals " << tTotals << ", by sector " << tGroups
+                  << (ok ? "" : " (MISMATCH)") << std::endl;
+    }
+    std::cout << "average days held " << scalar.averageDays() << ", max "
+              << scalar.maxDays << std::endl;
+
+    for (std::size_t i = 0; i < n; ++i) delete investments[i];
+    return 0;
+}
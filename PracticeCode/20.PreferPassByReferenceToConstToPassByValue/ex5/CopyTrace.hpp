@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+// 拷贝、移动的统计工具，代替在拷贝构造函数里手写 std::cout。
+//
+// 用法：类继承 CopyTraced<自己>。编译时定义 COPY_TRACE 才会统计，否则
+// CopyTraced 是一个空基类，没有任何开销。
+// - 编译器生成的拷贝、移动操作会自动调用基类的对应操作
+// - 自己写的拷贝构造函数和赋值运算符要像条款 12 那样显式调用
+//   CopyTraced<T>(rhs) 和 CopyTraced<T>::operator=(rhs)，否则不会被统计
+// - 拷贝的字节数默认是 sizeof(T)，可以在类所在的命名空间中重载
+//   std::size_t tracedBytes(const T&) 把堆上的数据也算进去
+// - COPY_TRACE_SCOPE() 标记一个调用点，setSampleEvery(n) 后同一类型的
+//   同一种事件每 n 次采样一次，按（类型、事件、调用点）汇总，报告中的
+//   次数是按采样率放大后的估计值
+// - report() 随时输出汇总，reportAtExit() 在程序退出时输出到 std::cerr
+
+namespace copytrace {
+
+enum Event {
+    kCopyConstruct,
+    kMoveConstruct,
+    kCopyAssign,
+    kMoveAssign,
+    kEvents
+};
+
+#ifdef COPY_TRACE
+
+// 每个类型一份，第一次用到时挂到全局链表上。对象故意不释放，
+// 这样退出时的报告不受静态对象析构顺序的影响
+struct TypeStats {
+    explicit TypeStats(const char* mangled_) : mangled(mangled_), next(0) {
+        for (int i = 0; i < kEvents; ++i) {
+            counts[i].store(0);
+            ticks[i].store(0);
+        }
+        bytes.store(0);
+    }
+
+    const char* mangled;
+    std::atomic<uint64_t> counts[kEvents];
+    // 采样用的计数器。每个类型、每种事件各一个：若所有事件共用一个计数器，
+    // 总是相继发生的事件（如派生类拷贝紧跟在基类拷贝之后）会互相错开，
+    // 其中一个永远采不到
+    std::atomic<uint64_t> ticks[kEvents];
+    std::atomic<uint64_t> bytes;
+    TypeStats* next;
+};
+
+inline std::atomic<TypeStats*>& registry() {
+    static std::atomic<TypeStats*> head(0);
+    return head;
+}
+
+inline TypeStats* registerType(const char* mangled) {
+    TypeStats* s = new TypeStats(mangled);
+    s->next = registry().load();
+    while (!registry().compare_exchange_weak(s->next, s)) {
+    }
+    return s;
+}
+
+inline std::atomic<unsigned>& sampleRate() {
+    static std::atomic<unsigned> every(0);
+    return every;
+}
+
+inline const char*& currentSite() {
+    static thread_local const char* site = 0;
+    return site;
+}
+
+typedef std::tuple<TypeStats*, int, std::string> SampleKey;
+
+struct SampleCount {
+    SampleCount() : samples(0), estimated(0) {}
+    uint64_t samples;
+    uint64_t estimated;  // 每个样本按采样时的采样率计入
+};
+
+struct SampleTable {
+    std::mutex mutex;
+    std::map<SampleKey, SampleCount> counts;
+};
+
+inline SampleTable& samples() {
+    static SampleTable* table = new SampleTable;
+    return *table;
+}
+
+inline void sample(TypeStats& s, Event e) {
+    unsigned every = sampleRate().load(std::memory_order_relaxed);
+    if (every == 0 ||
+        (s.ticks[e].fetch_add(1, std::memory_order_relaxed) + 1) % every != 0) {
+        return;
+    }
+    const char* site = currentSite();
+    try {
+        SampleTable& table = samples();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        SampleKey key(&s, e, site ? site : "(no scope)");
+        SampleCount& c = table.counts[key];
+        ++c.samples;
+        c.estimated += every;
+    } catch (...) {
+        // 统计失败不能影响被统计的拷贝
+    }
+}
+
+inline void record(TypeStats& s, Event e, std::size_t bytes) {
+    s.counts[e].fetch_add(1, std::memory_order_relaxed);
+    if (bytes) s.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    sample(s, e);
+}
+
+template <typename T>
+std::size_t tracedBytes(const T&) {
+    return sizeof(T);
+}
+
+// 依赖实参查找：类型自己的 tracedBytes 重载优先
+template <typename T>
+std::size_t bytesOf(const T& value) {
+    return tracedBytes(value);
+}
+
+inline std::string demangle(const char* mangled) {
+    int status = 0;
+    char* name = abi::__cxa_demangle(mangled, 0, 0, &status);
+    std::string result = status == 0 ? name : mangled;
+    std::free(name);
+    return result;
+}
+
+// 在作用域内发生的拷贝、移动都记到这个调用点上，可以嵌套
+class Scope {
+public:
+    explicit Scope(const char* site) : previous(currentSite()) {
+        currentSite() = site;
+    }
+    ~Scope() { currentSite() = previous; }
+
+private:
+    Scope(const Scope&);
+    Scope& operator=(const Scope&);
+
+    const char* previous;
+};
+
+inline void setSampleEvery(unsigned n) { sampleRate().store(n); }
+
+inline void reset() {
+    for (TypeStats* s = registry().load(); s; s = s->next) {
+        for (int i = 0; i < kEvents; ++i) {
+            s->counts[i].store(0);
+            s->ticks[i].store(0);
+        }
+        s->bytes.store(0);
+    }
+    std::lock_guard<std::mutex> lock(samples().mutex);
+    samples().counts.clear();
+}
+
+inline void report(std::ostream& os) {
+    static const char* kEventNames[] = {"copy-ctor", "move-ctor",
+                                        "copy-assign", "move-assign"};
+    std::vector<TypeStats*> types;
+    for (TypeStats* s = registry().load(); s; s = s->next) types.push_back(s);
+    std::sort(types.begin(), types.end(), [](TypeStats* a, TypeStats* b) {
+        return a->bytes.load() > b->bytes.load();
+    });
+    os << std::left << std::setw(20) << "type" << std::right;
+    for (int i = 0; i < kEvents; ++i) os << std::setw(13) << kEventNames[i];
+    os << std::setw(14) << "bytes copied" << "\n";
+    for (std::size_t i = 0; i < types.size(); ++i) {
+        os << std::left << std::setw(20) << demangle(types[i]->mangled)
+           << std::right;
+        for (int e = 0; e < kEvents; ++e) {
+            os << std::setw(13) << types[i]->counts[e].load();
+        }
+        os << std::setw(14) << types[i]->bytes.load() << "\n";
+    }
+
+    std::vector<std::pair<std::pair<uint64_t, uint64_t>, SampleKey> > sorted;
+    {
+        std::lock_guard<std::mutex> lock(samples().mutex);
+        std::map<SampleKey, SampleCount>::const_iterator it;
+        for (it = samples().counts.begin(); it != samples().counts.end();
+             ++it) {
+            sorted.push_back(std::make_pair(
+                std::make_pair(it->second.estimated, it->second.samples),
+                it->first));
+        }
+    }
+    if (sorted.empty()) return;
+    std::sort(sorted.rbegin(), sorted.rend());
+    os << "by call site (sampling 1 in " << sampleRate().load()
+       << " events per type and event):\n"
+       << std::setw(10) << "estimated" << std::setw(9) << "samples" << "\n";
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        const SampleKey& key = sorted[i].second;
+        os << std::setw(10) << sorted[i].first.first << std::setw(9)
+           << sorted[i].first.second << "  "
+           << demangle(std::get<0>(key)->mangled) << " "
+           << kEventNames[std::get<1>(key)] << " at " << std::get<2>(key)
+           << "\n";
+    }
+}
+
+inline void reportAtExit() {
+    struct Handler {
+        static void run() {
+            std::cerr << "copy trace summary:\n";
+            report(std::cerr);
+        }
+    };
+    std::atexit(&Handler::run);
+}
+
+}  // namespace copytrace
+
+template <typename Derived>
+class CopyTraced {
+public:
+    static copytrace::TypeStats& traceStats() {
+        static copytrace::TypeStats* stats =
+            copytrace::registerType(typeid(Derived).name());
+        return *stats;
+    }
+
+protected:
+    CopyTraced() {}
+
+    CopyTraced(const CopyTraced& rhs) {
+        copytrace::record(traceStats(), copytrace::kCopyConstruct,
+                          copytrace::bytesOf(derived(rhs)));
+    }
+
+    // noexcept：不能让 std::vector 因为这个基类而放弃移动
+    CopyTraced(CopyTraced&&) noexcept {
+        copytrace::record(traceStats(), copytrace::kMoveConstruct, 0);
+    }
+
+    CopyTraced& operator=(const CopyTraced& rhs) {
+        copytrace::record(traceStats(), copytrace::kCopyAssign,
+                          copytrace::bytesOf(derived(rhs)));
+        return *this;
+    }
+
+    CopyTraced& operator=(CopyTraced&&) noexcept {
+        copytrace::record(traceStats(), copytrace::kMoveAssign, 0);
+        return *this;
+    }
+
+    ~CopyTraced() {}
+
+private:
+    static const Derived& derived(const CopyTraced& b) {
+        return static_cast<const Derived&>(b);
+    }
+};
+
+#define COPY_TRACE_STR2(x) #x
+#define COPY_TRACE_STR(x) COPY_TRACE_STR2(x)
+#define COPY_TRACE_CAT2(a, b) a##b
+#define COPY_TRACE_CAT(a, b) COPY_TRACE_CAT2(a, b)
+#define COPY_TRACE_SCOPE()                                      \
+    copytrace::Scope COPY_TRACE_CAT(copyTraceScope, __LINE__)( \
+        __FILE__ ":" COPY_TRACE_STR(__LINE__))
+
+#else  // COPY_TRACE
+
+inline void setSampleEvery(unsigned) {}
+inline void reset() {}
+inline void report(std::ostream& os) {
+    os << "copy tracing disabled, build with -DCOPY_TRACE\n";
+}
+inline void reportAtExit() {}
+
+}  // namespace copytrace
+
+// 关闭时是空基类，空基类优化后不占空间，拷贝、移动都是平凡的
+template <typename Derived>
+class CopyTraced {};
+
+#define COPY_TRACE_SCOPE()
+
+#endif  // COPY_TRACE
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CopyTrace.hpp"
+
+// 用 CopyTraced 代替各个拷贝构造函数里的 std::cout，统计条款 11、12、20
+// 中各个类被拷贝、移动的次数。编译时去掉 -DCOPY_TRACE 就没有任何开销。
+
+class Age : public CopyTraced<Age> {
+private:
+    int age = 0;
+};
+
+class Person : public CopyTraced<Person> {
+public:
+    Person() {}
+    // 声明了析构函数，编译器不再生成移动操作，“移动”其实都是拷贝
+    virtual ~Person() {}
+
+private:
+    Age age;
+    std::string name;
+    std::string address;
+};
+
+class Student : public Person, public CopyTraced<Student> {
+private:
+    std::string schoolName;
+    std::string schoolAdress;
+};
+
+class Customer : public CopyTraced<Customer> {
+public:
+    Customer() {}
+    Customer(const std::string& name_, const std::string& date_)
+        : name(name_), date(date_) {}
+    Customer(const Customer& rhs);
+    Customer& operator=(const Customer& rhs);
+
+    const std::string& getDate() const { return date; }
+
+    // 把字符串在堆上的部分也算进去
+    friend std::size_t tracedBytes(const Customer& c) {
+        return sizeof(c) + c.name.capacity() + c.date.capacity();
+    }
+
+private:
+    std::string name;
+    std::string date;
+};
+
+Customer::Customer(const Customer& rhs)
+    : CopyTraced<Customer>(rhs), name(rhs.name), date(rhs.date) {}
+
+Customer& Customer::operator=(const Customer& rhs) {
+    CopyTraced<Customer>::operator=(rhs);
+    name = rhs.name;
+    date = rhs.date;
+    return *this;
+}
+
+class PriorityCustomer : public Customer, public CopyTraced<PriorityCustomer> {
+public:
+    PriorityCustomer(const std::string& name_, const std::string& date_,
+                     int priority_)
+        : Customer(name_, date_), priority(priority_) {}
+    PriorityCustomer(const PriorityCustomer& rhs)
+        : Customer(rhs),  // 调用基类 copy constructor
+          CopyTraced<PriorityCustomer>(rhs),
+          priority(rhs.priority) {}
+
+    PriorityCustomer& operator=(const PriorityCustomer& rhs) {
+        Customer::operator=(rhs);  // 调用基类 copy assignment
+        CopyTraced<PriorityCustomer>::operator=(rhs);
+        priority = rhs.priority;
+        return *this;
+    }
+
+private:
+    int priority;
+};
+
+class BitMap : public CopyTraced<BitMap> {
+public:
+    explicit BitMap(std::size_t bits = 0) : words((bits + 63) / 64, 0) {}
+
+    void set(std::size_t i) { words[i / 64] |= 1ULL << (i % 64); }
+
+    friend std::size_t tracedBytes(const BitMap& b) {
+        return sizeof(b) + b.words.size() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+// test function (pass by value)
+bool validateStudent(Student) { return false; }
+
+// test function (pass by reference to const)
+bool validateStudentByRef(const Student&) { return false; }
+
+std::vector<Student> enroll(std::size_t n) {
+    COPY_TRACE_SCOPE();
+    std::vector<Student> students;
+    for (std::size_t i = 0; i < n; ++i) students.push_back(Student());
+    return students;
+}
+
+void sortByDate(std::vector<PriorityCustomer>& customers) {
+    COPY_TRACE_SCOPE();
+    std::sort(customers.begin(), customers.end(),
+              [](const Customer& a, const Customer& b) {
+                  return a.getDate() < b.getDate();
+              });
+}
+
+std::vector<BitMap> snapshot(const std::vector<BitMap>& maps) {
+    COPY_TRACE_SCOPE();
+    std::vector<BitMap> copy = maps;
+    std::vector<BitMap> moved(std::move(copy));  // 只交换指针，不移动元素
+    return moved;
+}
+
+int main() {
+    copytrace::reportAtExit();
+    copytrace::setSampleEvery(1);
+
+    // 1. 条款 20：按值传递会拷贝 Student、Person 和 Age。
+    //    参数在调用方构造，所以调用点要标记在调用方
+    Student plato;
+    {
+        COPY_TRACE_SCOPE();
+        validateStudent(plato);
+    }
+    {
+        COPY_TRACE_SCOPE();
+        validateStudentByRef(plato);
+    }
+    std::cout << "after validateStudent:\n";
+    copytrace::report(std::cout);
+    copytrace::reset();
+
+    // 2. 热路径上隐藏的拷贝：
+    //    - Person 没有移动操作，Student 的移动构造函数会拷贝 Person，
+    //      也就不是 noexcept 的，vector 扩容时只能逐个拷贝
+    //    - Customer 自定义了拷贝构造函数，std::sort 交换元素时也是拷贝
+    copytrace::setSampleEvery(16);
+    std::vector<Student> students = enroll(1000);
+    std::vector<PriorityCustomer> customers;
+    for (int i = 0; i < 1000; ++i) {
+        customers.push_back(PriorityCustomer(
+            "customer", i % 2 ? "2020-10-03" : "2020-10-01", i % 5));
+    }
+    sortByDate(customers);
+    std::vector<BitMap> maps(100, BitMap(4096));
+    std::vector<BitMap> copies = snapshot(maps);
+    std::cout << "\nafter hot paths:\n";
+    copytrace::report(std::cout);
+
+    // 3. 退出时 reportAtExit 再输出一次
+    customers[0] = customers[1];
+    copies[0] = std::move(copies[1]);
+    return 0;
+}